@@ -17,6 +17,9 @@ Application::Application(const char* caption, int width, int height)
 	this->keystate = SDL_GetKeyboardState(NULL);
 
 	framebuffer.resize(w, h);
+
+	this->scene_version = 0;
+	this->rendered_scene_version = 0;
 }
 
 //Here we have already GL working, so we can create meshes and textures
@@ -30,14 +33,19 @@ void Application::init(void)
 	_lineDst = Vector2{};
 	_drawLine = false;
 
+	canvas.background = Color::BLACK;
+	_circle = canvas.addCircle(window_width / 2, window_height / 2, 100, Color::RED, true);
+
 	//landscape.scale(framebuffer.width, framebuffer.height);
 }
 
 //render one frame
 void Application::render( Image& framebuffer )
 {
-	//clear framebuffer if we want to start from scratch
-	framebuffer.fill(Color::BLACK);
+	rendered_scene_version = scene_version;
+
+	//the framebuffer keeps the last frame, the canvas only clears and redraws the areas that changed
+	canvas.update(framebuffer);
 
 	/*if (_drawLine)
 	{
@@ -57,8 +65,6 @@ void Application::render( Image& framebuffer )
 		);
 	}*/
 
-	framebuffer.drawCircle(window_width / 2, window_height / 2, 100, Color::RED, true);
-
 	//render_idea3(1);
 
 	//here you can add your code to fill the framebuffer
@@ -111,6 +117,7 @@ void Application::onMouseButtonDown( SDL_MouseButtonEvent event )
 		//if you read mouse position from the event, careful, Y is reversed, use mouse_position instead
 		_lineOrg.set(static_cast<float>(event.x), window_height - static_cast<float>(event.y));
 		_drawLine = false;
+		scene_version++;
 	}
 }
 
@@ -120,6 +127,7 @@ void Application::onMouseButtonUp( SDL_MouseButtonEvent event )
 	{
 		_lineDst.set(static_cast<float>(event.x), window_height - static_cast<float>(event.y));
 		_drawLine = true;
+		scene_version++;
 	}
 }
 
@@ -8,6 +8,7 @@
 #include "includes.h"
 #include "framework.h"
 #include "image.h"
+#include "canvas.h"
 
 class Application
 {
@@ -21,6 +22,10 @@ public:
 
 	float time;
 
+	//the loop only calls render when something changed since the last frame
+	unsigned int scene_version; //increase it when something that is drawn changes
+	unsigned int rendered_scene_version;
+
 	//keyboard state
 	const Uint8* keystate;
 
@@ -36,6 +41,8 @@ public:
 	void init( void );
 	void render( Image& framebuffer );
 	void update( double dt );
+	bool needsRender() { return scene_version != rendered_scene_version || canvas.isDirty(); } //true if the last rendered frame is out of date
+	const std::vector<Rect>& getUpdatedRects() const { return canvas.getUpdatedRects(); } //areas of the framebuffer changed by the last render
 
 	//methods for events
 	void onKeyDown( SDL_KeyboardEvent event );
@@ -49,6 +56,9 @@ public:
 		this->window_width = width;
 		this->window_height = height;
 		framebuffer.resize(width,height);
+		canvas.invalidate(); //the content of the framebuffer is lost
+		canvas.moveTo(_circle, width / 2, height / 2);
+		scene_version++;
 	}
 
 	Vector2 getWindowSize()
@@ -62,7 +72,9 @@ public:
 
 	/* My stuff */
 private:
-	//Image _canvas;
+	//what is drawn in the framebuffer, only the parts that change are redrawn
+	Canvas canvas;
+	unsigned int _circle;
 
 	Vector2 _lineOrg;
 	Vector2 _lineDst;
@@ -0,0 +1,88 @@
+#include "blitter.h"
+#include "resample.h"
+#include <vector>
+
+//dst = (src * alpha + dst * (255 - alpha)) / 255, on the bytes of the row
+static void blendRow(unsigned char* dst, const unsigned char* src, unsigned int count, unsigned int alpha)
+{
+	unsigned int inv_alpha = 255 - alpha;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		unsigned int v = src[i] * alpha + dst[i] * inv_alpha + 128;
+		dst[i] = (unsigned char)((v + (v >> 8)) >> 8); //divides by 255
+	}
+}
+
+static void keyRow(Color* dst, const Color* src, unsigned int count, const Color& key)
+{
+	for (unsigned int i = 0; i < count; ++i)
+		if (src[i].r != key.r || src[i].g != key.g || src[i].b != key.b)
+			dst[i] = src[i];
+}
+
+static void blendKeyRow(Color* dst, const Color* src, unsigned int count, unsigned int alpha, const Color& key)
+{
+	for (unsigned int i = 0; i < count; ++i)
+		if (src[i].r != key.r || src[i].g != key.g || src[i].b != key.b)
+			blendRow(dst[i].v, src[i].v, 3, alpha);
+}
+
+//the scaled sprite of the blends goes here, it only grows so the calls after the first one don't allocate
+static Color* scaledBuffer(unsigned int count)
+{
+	static thread_local std::vector<Color> buffer;
+	if (buffer.size() < count)
+		buffer.resize(count);
+	return &buffer[0];
+}
+
+void blit(const ImageView& target, const ImageView& sprite, int x, int y, unsigned int w, unsigned int h, const BlitOptions& options)
+{
+	if (!w) w = sprite.width;
+	if (!h) h = sprite.height;
+	if (target.isEmpty() || sprite.isEmpty() || !options.alpha)
+		return;
+
+	//the part of the (scaled) sprite inside the target
+	long long min_x = x > 0 ? x : 0, min_y = y > 0 ? y : 0;
+	long long max_x = std::min((long long)x + w, (long long)target.width);
+	long long max_y = std::min((long long)y + h, (long long)target.height);
+	if (min_x >= max_x || min_y >= max_y)
+		return;
+	ImageView area = target.getArea((unsigned int)min_x, (unsigned int)min_y, (unsigned int)(max_x - min_x), (unsigned int)(max_y - min_y));
+	unsigned int skip_x = (unsigned int)(min_x - x), skip_y = (unsigned int)(min_y - y);
+
+	bool opaque = options.alpha == 255 && !options.use_color_key;
+	bool scaled = w != sprite.width || h != sprite.height;
+	ResampleFilter filter = options.use_color_key ? RESAMPLE_NEAREST : options.filter;
+
+	//the pixels that go to the area
+	ImageView src;
+	if (!scaled)
+		src = sprite.getArea(skip_x, skip_y, area.width, area.height);
+	else if (opaque)
+	{
+		//nothing to combine, it is scaled straight into the target
+		resample(sprite, w, h, skip_x, skip_y, area, filter);
+		return;
+	}
+	else
+	{
+		src = ImageView(scaledBuffer(area.width * area.height), area.width, area.height, area.width);
+		resample(sprite, w, h, skip_x, skip_y, src, filter);
+	}
+
+	for (unsigned int j = 0; j < area.height; ++j)
+	{
+		Color* dst_row = area.getRow(j);
+		const Color* src_row = src.getRow(j);
+		if (opaque)
+			memcpy(dst_row, src_row, area.width * sizeof(Color));
+		else if (!options.use_color_key)
+			blendRow((unsigned char*)dst_row, (const unsigned char*)src_row, area.width * 3, options.alpha);
+		else if (options.alpha == 255)
+			keyRow(dst_row, src_row, area.width, options.color_key);
+		else
+			blendKeyRow(dst_row, src_row, area.width, options.alpha, options.color_key);
+	}
+}
@@ -0,0 +1,28 @@
+/*  Blitter: draws images (sprites) over other images.
+	The sprite is clipped against the target first, so the rest only touches the visible pixels. Every row is processed
+	by a kernel chosen once per blit: a memcpy when it is opaque, or loops over the bytes of the row (that the
+	compiler can vectorize) to blend it or to skip the pixels of the color key.
+	Scaled sprites go through the resampler, only for the visible part.
+*/
+
+#ifndef BLITTER_H
+#define BLITTER_H
+
+#include "image.h"
+
+//how the sprite is combined with the pixels under it
+struct BlitOptions
+{
+	unsigned char alpha;	//opacity of the whole sprite, 255 covers what is under it
+	bool use_color_key;
+	Color color_key;		//with use_color_key the pixels of this color are not drawn (it scales with RESAMPLE_NEAREST to keep them)
+	ResampleFilter filter;	//used when the sprite is scaled
+
+	BlitOptions() { alpha = 255; use_color_key = false; filter = RESAMPLE_NEAREST; }
+};
+
+//draws sprite in target with its top-left corner at x,y (it can be partly or totally outside)
+//w and h stretch it (0 keeps its size), the views must not overlap
+void blit(const ImageView& target, const ImageView& sprite, int x, int y, unsigned int w = 0, unsigned int h = 0, const BlitOptions& options = BlitOptions());
+
+#endif
@@ -0,0 +1,193 @@
+#include "canvas.h"
+#include <algorithm>
+
+//when there are more dirty rectangles than this they are joined in one, testing every primitive
+//against too many small rectangles costs more than redrawing a bit of extra area
+#define MAX_DIRTY_RECTS 16
+
+Rect Rect::intersection(const Rect& r) const
+{
+	return Rect(std::max(min_x, r.min_x), std::max(min_y, r.min_y), std::min(max_x, r.max_x), std::min(max_y, r.max_y));
+}
+
+void Rect::merge(const Rect& r)
+{
+	if (r.isEmpty())
+		return;
+	if (isEmpty())
+	{
+		*this = r;
+		return;
+	}
+	min_x = std::min(min_x, r.min_x);
+	min_y = std::min(min_y, r.min_y);
+	max_x = std::max(max_x, r.max_x);
+	max_y = std::max(max_y, r.max_y);
+}
+
+Canvas::Canvas()
+{
+	background = Color::BLACK;
+	full_redraw = true;
+}
+
+unsigned int Canvas::addLine(int x0, int y0, int x1, int y1, const Color& color, bool bresenham)
+{
+	Primitive p;
+	p.type = bresenham ? LINE_BRESENHAM : LINE_DDA;
+	p.x0 = x0; p.y0 = y0;
+	p.x1 = x1; p.y1 = y1;
+	p.radius = 0;
+	p.fill = false;
+	p.color = color;
+	p.alive = true;
+	updateBounds(p);
+	markDirty(p.bounds);
+	primitives.push_back(p);
+	return static_cast<unsigned int>(primitives.size() - 1);
+}
+
+unsigned int Canvas::addCircle(int x, int y, int radius, const Color& color, bool fill)
+{
+	Primitive p;
+	p.type = CIRCLE;
+	p.x0 = p.x1 = x;
+	p.y0 = p.y1 = y;
+	p.radius = radius;
+	p.fill = fill;
+	p.color = color;
+	p.alive = true;
+	updateBounds(p);
+	markDirty(p.bounds);
+	primitives.push_back(p);
+	return static_cast<unsigned int>(primitives.size() - 1);
+}
+
+void Canvas::move(unsigned int id, int dx, int dy)
+{
+	Primitive& p = primitives[id];
+	if (!p.alive || (dx == 0 && dy == 0))
+		return;
+
+	//the old area must be cleared and the new one drawn
+	markDirty(p.bounds);
+	p.x0 += dx; p.y0 += dy;
+	p.x1 += dx; p.y1 += dy;
+	updateBounds(p);
+	markDirty(p.bounds);
+}
+
+void Canvas::moveTo(unsigned int id, int x, int y)
+{
+	const Primitive& p = primitives[id];
+	move(id, x - p.x0, y - p.y0);
+}
+
+void Canvas::setColor(unsigned int id, const Color& color)
+{
+	Primitive& p = primitives[id];
+	if (!p.alive)
+		return;
+	p.color = color;
+	markDirty(p.bounds);
+}
+
+void Canvas::remove(unsigned int id)
+{
+	Primitive& p = primitives[id];
+	if (!p.alive)
+		return;
+	p.alive = false;
+	markDirty(p.bounds);
+}
+
+void Canvas::clear()
+{
+	primitives.clear();
+	dirty_rects.clear();
+	full_redraw = true;
+}
+
+void Canvas::updateBounds(Primitive& p)
+{
+	if (p.type == CIRCLE)
+		p.bounds = Rect(p.x0 - p.radius, p.y0 - p.radius, p.x0 + p.radius, p.y0 + p.radius);
+	else
+		p.bounds = Rect(std::min(p.x0, p.x1), std::min(p.y0, p.y1), std::max(p.x0, p.x1), std::max(p.y0, p.y1));
+}
+
+void Canvas::markDirty(const Rect& rect)
+{
+	if (full_redraw || rect.isEmpty())
+		return;
+
+	//join it with the rectangles it overlaps, the result may overlap others so it is checked again
+	Rect r = rect;
+	bool merged = true;
+	while (merged)
+	{
+		merged = false;
+		for (unsigned int i = 0; i < dirty_rects.size(); ++i)
+			if (dirty_rects[i].intersects(r))
+			{
+				r.merge(dirty_rects[i]);
+				dirty_rects[i] = dirty_rects.back();
+				dirty_rects.pop_back();
+				merged = true;
+				break;
+			}
+	}
+	dirty_rects.push_back(r);
+
+	if (dirty_rects.size() > MAX_DIRTY_RECTS)
+	{
+		for (unsigned int i = 1; i < dirty_rects.size(); ++i)
+			dirty_rects[0].merge(dirty_rects[i]);
+		dirty_rects.resize(1);
+	}
+}
+
+void Canvas::draw(const Primitive& p, Image& target)
+{
+	switch (p.type)
+	{
+		case LINE_DDA: target.drawLineDDL(p.x0, p.y0, p.x1, p.y1, p.color); break;
+		case LINE_BRESENHAM: target.drawLineBresenham(p.x0, p.y0, p.x1, p.y1, p.color); break;
+		case CIRCLE: target.drawCircle(p.x0, p.y0, p.radius, p.color, p.fill); break;
+	}
+}
+
+bool Canvas::update(Image& target)
+{
+	updated_rects.clear();
+	Rect screen(0, 0, static_cast<int>(target.width) - 1, static_cast<int>(target.height) - 1);
+	if (full_redraw)
+	{
+		dirty_rects.clear();
+		dirty_rects.push_back(screen);
+		full_redraw = false;
+	}
+
+	for (unsigned int i = 0; i < dirty_rects.size(); ++i)
+	{
+		Rect r = dirty_rects[i].intersection(screen);
+		if (r.isEmpty())
+			continue;
+
+		//clear the area and redraw the primitives that touch it (in order, so the overlaps are the same)
+		target.getView(r.min_x, r.min_y, r.max_x - r.min_x + 1, r.max_y - r.min_y + 1).fill(background);
+
+		target.setClipRect(r.min_x, r.min_y, r.max_x, r.max_y);
+		for (unsigned int j = 0; j < primitives.size(); ++j)
+		{
+			const Primitive& p = primitives[j];
+			if (p.alive && p.bounds.intersects(r))
+				draw(p, target);
+		}
+		updated_rects.push_back(r);
+	}
+	target.resetClipRect();
+	dirty_rects.clear();
+
+	return !updated_rects.empty();
+}
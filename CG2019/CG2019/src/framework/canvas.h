@@ -0,0 +1,88 @@
+/*  Retained list of 2D primitives drawn over an Image.
+	Every primitive keeps its bounding rectangle. When primitives are added, moved or removed only the rectangles
+	they covered are marked as dirty, and update() clears and redraws just those areas (with the Image clip rect),
+	so the cost of a change depends on its size and not on the size of the whole drawing.
+*/
+
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <vector>
+#include "framework.h"
+#include "image.h"
+
+//rectangle in pixels, both corners inclusive
+class Rect
+{
+public:
+	int min_x, min_y;
+	int max_x, max_y;
+
+	Rect() { min_x = min_y = 0; max_x = max_y = -1; }
+	Rect(int min_x, int min_y, int max_x, int max_y) { this->min_x = min_x; this->min_y = min_y; this->max_x = max_x; this->max_y = max_y; }
+
+	bool isEmpty() const { return max_x < min_x || max_y < min_y; }
+	int getWidth() const { return max_x - min_x + 1; }
+	int getHeight() const { return max_y - min_y + 1; }
+
+	bool intersects(const Rect& r) const { return min_x <= r.max_x && r.min_x <= max_x && min_y <= r.max_y && r.min_y <= max_y; }
+	Rect intersection(const Rect& r) const;
+	void merge(const Rect& r); //grows to contain r
+};
+
+class Canvas
+{
+public:
+	enum PrimitiveType { LINE_DDA, LINE_BRESENHAM, CIRCLE };
+
+	struct Primitive
+	{
+		PrimitiveType type;
+		int x0, y0;		//first point of a line or center of a circle
+		int x1, y1;		//second point of a line
+		int radius;
+		bool fill;
+		Color color;
+		Rect bounds;
+		bool alive;		//removed primitives keep their place so the ids don't change
+	};
+
+	Color background;
+
+	Canvas();
+
+	//add a primitive and get its id
+	unsigned int addLine(int x0, int y0, int x1, int y1, const Color& color, bool bresenham = true);
+	unsigned int addCircle(int x, int y, int radius, const Color& color, bool fill);
+
+	//edit a primitive
+	void move(unsigned int id, int dx, int dy);
+	void moveTo(unsigned int id, int x, int y); //moves it so the first point (or the center) ends at x,y
+	void setColor(unsigned int id, const Color& color);
+	void remove(unsigned int id);
+	void clear();
+
+	const Primitive& getPrimitive(unsigned int id) const { return primitives[id]; }
+
+	//everything must be redrawn on the next update (the target was resized or its content is lost)
+	void invalidate() { full_redraw = true; }
+	bool isDirty() const { return full_redraw || !dirty_rects.empty(); }
+
+	//redraws the dirty areas in the target, returns false if there was nothing to do
+	bool update(Image& target);
+
+	//areas of the target changed by the last update, so only those need to be sent to the screen
+	const std::vector<Rect>& getUpdatedRects() const { return updated_rects; }
+
+private:
+	std::vector<Primitive> primitives;
+	std::vector<Rect> dirty_rects;
+	std::vector<Rect> updated_rects;
+	bool full_redraw;
+
+	void markDirty(const Rect& rect);
+	void updateBounds(Primitive& p);
+	void draw(const Primitive& p, Image& target);
+};
+
+#endif
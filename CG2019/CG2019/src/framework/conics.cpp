@@ -0,0 +1,275 @@
+#include "conics.h"
+#include <vector>
+#include <cmath>
+
+//pixel centers closer than this to the border of an arc are inside it
+#define ARC_EPSILON 1e-6
+
+//the pixels of a shape centered at 0,0 by rows: the rows k and -k go from inner[k] to outer[k] at both sides
+struct ConicRows
+{
+	std::vector<int> inner;
+	std::vector<int> outer;
+
+	ConicRows(int radius_y) : inner(radius_y + 1, INT_MAX), outer(radius_y + 1, -1) {}
+
+	//x and y are positive
+	void addPoint(int x, int y)
+	{
+		if (x < inner[y]) inner[y] = x;
+		if (x > outer[y]) outer[y] = x;
+	}
+};
+
+static void computeCircle(int radius, ConicRows& rows)
+{
+	int dx = 0, dy = radius, v = 1 - radius;
+	rows.addPoint(dx, dy);
+	rows.addPoint(dy, dx);
+	while (dy >= dx)
+	{
+		if (v < 0)
+		{
+			v += 2 * dx + 3;
+			++dx;
+		}
+		else
+		{
+			v += 2 * (dx - dy) + 5;
+			++dx;
+			--dy;
+		}
+		//the last step can cross the diagonal, its pixels are still part of the circle
+		if (dy >= 0)
+		{
+			rows.addPoint(dx, dy);
+			rows.addPoint(dy, dx);
+		}
+	}
+}
+
+static void computeEllipse(int radius_x, int radius_y, ConicRows& rows)
+{
+	if (radius_x == radius_y)
+	{
+		computeCircle(radius_x, rows);
+		return;
+	}
+	if (!radius_x || !radius_y)
+	{
+		//a line
+		for (int y = 0; y <= radius_y; ++y)
+		{
+			rows.addPoint(0, y);
+			rows.addPoint(radius_x, y);
+		}
+		return;
+	}
+
+	//the decision values are multiplied by 4 to stay integers
+	long long rx2 = (long long)radius_x * radius_x, ry2 = (long long)radius_y * radius_y;
+	int x = 0, y = radius_y;
+	long long px = 0, py = 2 * rx2 * y;
+	long long d = 4 * ry2 - 4 * rx2 * radius_y + rx2;
+	rows.addPoint(x, y);
+
+	//while the slope is under 1 x always advances
+	while (px < py)
+	{
+		++x;
+		px += 2 * ry2;
+		if (d < 0)
+			d += 4 * (ry2 + px);
+		else
+		{
+			--y;
+			py -= 2 * rx2;
+			d += 4 * (ry2 + px - py);
+		}
+		rows.addPoint(x, y);
+	}
+
+	//then y always advances
+	d = ry2 * (2 * x + 1) * (2 * x + 1) + 4 * rx2 * (long long)(y - 1) * (y - 1) - 4 * rx2 * ry2;
+	while (y > 0)
+	{
+		--y;
+		py -= 2 * rx2;
+		if (d > 0)
+			d += 4 * (rx2 - py);
+		else
+		{
+			++x;
+			px += 2 * ry2;
+			d += 4 * (rx2 - py + px);
+		}
+		rows.addPoint(x, y);
+	}
+}
+
+//limits the span [x0, x1] of the row to the pixel centers inside the arc (cross products against the borders, for that row
+//they are a limit for x), it can end split in two
+struct ArcSector
+{
+	double start_x, start_y, end_x, end_y;
+	bool convex; //up to half a turn
+};
+
+//restricts [x0, x1] to the x with a * x >= b (or > b with strict)
+static void limitSpan(double a, double b, bool strict, int& x0, int& x1)
+{
+	if (fabs(a) < ARC_EPSILON)
+	{
+		if (strict ? !(b < -ARC_EPSILON) : !(b <= ARC_EPSILON))
+			x1 = x0 - 1;
+		return;
+	}
+	double t = b / a;
+	if (a > 0)
+	{
+		double first = strict ? floor(t + ARC_EPSILON) + 1 : ceil(t - ARC_EPSILON);
+		if (first > x0) x0 = first > x1 ? x1 + 1 : (int)first;
+	}
+	else
+	{
+		double last = strict ? ceil(t - ARC_EPSILON) - 1 : floor(t + ARC_EPSILON);
+		if (last < x1) x1 = last < x0 ? x0 - 1 : (int)last;
+	}
+}
+
+static void fillSpan(const ImageView& target, const DrawClip& clip, int y, long long x0, long long x1, const Color& color)
+{
+	if (x0 < clip.min_x) x0 = clip.min_x;
+	if (x1 > clip.max_x) x1 = clip.max_x;
+	if (x0 <= x1)
+		fillPixels(target.getRow(y) + x0, (unsigned int)(x1 - x0 + 1), color);
+}
+
+//x0 and x1 are relative to the center, dy is the row relative to it
+static void drawSpan(const ImageView& target, const DrawClip& clip, const ArcSector* sector, int x, int y, int dy, int x0, int x1, const Color& color)
+{
+	if (!sector)
+	{
+		fillSpan(target, clip, y + dy, (long long)x + x0, (long long)x + x1, color);
+		return;
+	}
+
+	//cross(start, p) >= 0 and cross(p, end) >= 0, with p = (dx, dy)
+	if (sector->convex)
+	{
+		limitSpan(-sector->start_y, -sector->start_x * dy, false, x0, x1);
+		limitSpan(sector->end_y, sector->end_x * dy, false, x0, x1);
+		if (x0 <= x1)
+			fillSpan(target, clip, y + dy, (long long)x + x0, (long long)x + x1, color);
+		return;
+	}
+
+	//more than half a turn, what is left out is the convex part from end to start (without its borders)
+	int out0 = x0, out1 = x1;
+	limitSpan(-sector->end_y, -sector->end_x * dy, true, out0, out1);
+	limitSpan(sector->start_y, sector->start_x * dy, true, out0, out1);
+	if (out0 > out1)
+	{
+		fillSpan(target, clip, y + dy, (long long)x + x0, (long long)x + x1, color);
+		return;
+	}
+	if (x0 < out0)
+		fillSpan(target, clip, y + dy, (long long)x + x0, (long long)x + out0 - 1, color);
+	if (out1 < x1)
+		fillSpan(target, clip, y + dy, (long long)x + out1 + 1, (long long)x + x1, color);
+}
+
+//writes every row of the shape once, with fill from -outer to outer (minus the hole, if any), if not only the outline
+static void drawRows(const ImageView& target, const DrawClip& clip, int x, int y, const ConicRows& rows, const ConicRows* hole, const ArcSector* sector, bool fill, const Color& color)
+{
+	int num_rows = (int)rows.outer.size();
+	for (int k = 0; k < num_rows; ++k)
+	{
+		int outer = rows.outer[k];
+		if (outer < 0)
+			continue;
+		int inner = rows.inner[k];
+		if (fill)
+			inner = hole && k < (int)hole->outer.size() && hole->outer[k] >= 0 ? hole->outer[k] + 1 : 0;
+		if (inner > outer)
+			continue;
+
+		for (int side = 0; side < (k ? 2 : 1); ++side)
+		{
+			int dy = side ? -k : k;
+			long long row = (long long)y + dy;
+			if (row < clip.min_y || row > clip.max_y)
+				continue;
+			if (!inner)
+				drawSpan(target, clip, sector, x, y, dy, -outer, outer, color);
+			else
+			{
+				drawSpan(target, clip, sector, x, y, dy, -outer, -inner, color);
+				drawSpan(target, clip, sector, x, y, dy, inner, outer, color);
+			}
+		}
+	}
+}
+
+void drawCircle(const ImageView& target, const DrawClip& clip, int x, int y, int radius, const Color& color, bool fill)
+{
+	if (radius < 0 || clip.min_x > clip.max_x || clip.min_y > clip.max_y)
+		return;
+	ConicRows rows(radius);
+	computeCircle(radius, rows);
+	drawRows(target, clip, x, y, rows, NULL, NULL, fill, color);
+}
+
+void drawEllipse(const ImageView& target, const DrawClip& clip, int x, int y, int radius_x, int radius_y, const Color& color, bool fill)
+{
+	if (radius_x < 0 || radius_y < 0 || clip.min_x > clip.max_x || clip.min_y > clip.max_y)
+		return;
+	ConicRows rows(radius_y);
+	computeEllipse(radius_x, radius_y, rows);
+	drawRows(target, clip, x, y, rows, NULL, NULL, fill, color);
+}
+
+void drawArc(const ImageView& target, const DrawClip& clip, int x, int y, int radius, float start_angle, float end_angle, const Color& color, bool fill)
+{
+	if (radius < 0 || clip.min_x > clip.max_x || clip.min_y > clip.max_y)
+		return;
+	ConicRows rows(radius);
+	computeCircle(radius, rows);
+
+	//a whole turn or more is the circle
+	double sweep = (double)end_angle - start_angle;
+	if (sweep >= 2 * PI)
+	{
+		drawRows(target, clip, x, y, rows, NULL, NULL, fill, color);
+		return;
+	}
+	sweep = fmod(sweep, 2 * PI);
+	if (sweep < 0)
+		sweep += 2 * PI;
+	if (sweep == 0)
+		return; //the sector would be the whole line through the start, both ways
+
+	ArcSector sector;
+	sector.start_x = cos((double)start_angle);
+	sector.start_y = sin((double)start_angle);
+	sector.end_x = cos((double)start_angle + sweep);
+	sector.end_y = sin((double)start_angle + sweep);
+	sector.convex = sweep <= PI;
+	drawRows(target, clip, x, y, rows, NULL, &sector, fill, color);
+}
+
+void drawRing(const ImageView& target, const DrawClip& clip, int x, int y, int inner_radius, int outer_radius, const Color& color)
+{
+	if (outer_radius < 0 || inner_radius > outer_radius || clip.min_x > clip.max_x || clip.min_y > clip.max_y)
+		return;
+	ConicRows rows(outer_radius);
+	computeCircle(outer_radius, rows);
+	if (inner_radius <= 0)
+	{
+		drawRows(target, clip, x, y, rows, NULL, NULL, true, color);
+		return;
+	}
+	ConicRows hole(inner_radius - 1);
+	computeCircle(inner_radius - 1, hole);
+	drawRows(target, clip, x, y, rows, &hole, NULL, true, color);
+}
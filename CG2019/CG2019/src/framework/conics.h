@@ -0,0 +1,25 @@
+/*  Conics: circles, ellipses, rings and arcs drawn as horizontal spans.
+	The shape is computed once for a quadrant (midpoint algorithms), as the first and last pixel of every row, and then
+	every row of the image is written once with one or two spans: clipped against the clip rectangle and filled with
+	fillPixels, so the cost is the one of writing the covered pixels.
+	The angles are in radians, from the +x axis towards +y (counterclockwise on the screen, y grows upwards).
+*/
+
+#ifndef CONICS_H
+#define CONICS_H
+
+#include "image.h"
+
+//the outline or the whole circle, the pixels are the ones of the midpoint algorithm
+void drawCircle(const ImageView& target, const DrawClip& clip, int x, int y, int radius, const Color& color, bool fill);
+
+//axis aligned, radius_x and radius_y are the half sizes
+void drawEllipse(const ImageView& target, const DrawClip& clip, int x, int y, int radius_x, int radius_y, const Color& color, bool fill);
+
+//the part of the circle from start_angle to end_angle, with fill it is a pie slice
+void drawArc(const ImageView& target, const DrawClip& clip, int x, int y, int radius, float start_angle, float end_angle, const Color& color, bool fill);
+
+//the pixels of the filled circle of outer_radius that are not in the one of inner_radius - 1
+void drawRing(const ImageView& target, const DrawClip& clip, int x, int y, int inner_radius, int outer_radius, const Color& color);
+
+#endif
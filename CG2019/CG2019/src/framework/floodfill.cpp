@@ -0,0 +1,104 @@
+#include "floodfill.h"
+#include <vector>
+
+//a run of the row y to check, the row y - dy is already filled from x0 to x1
+struct FillSpan
+{
+	int y, x0, x1, dy;
+};
+
+//the color of the region repeated 4 times, as 12 bytes
+struct FillPattern
+{
+	Color color;
+	unsigned int words[3];
+
+	FillPattern(const Color& c)
+	{
+		Color block[4] = { c, c, c, c };
+		color = c;
+		memcpy(words, block, sizeof(words));
+	}
+};
+
+static inline bool samePixel(const Color& a, const Color& b) { return a.r == b.r && a.g == b.g && a.b == b.b; }
+
+static inline bool sameBlock(const Color* pixels, const FillPattern& pattern)
+{
+	unsigned int words[3];
+	memcpy(words, pixels, sizeof(words));
+	return words[0] == pattern.words[0] && words[1] == pattern.words[1] && words[2] == pattern.words[2];
+}
+
+//how many pixels of the pattern color there are from x to the right, up to max_x
+static int matchRight(const Color* row, int x, int max_x, const FillPattern& pattern)
+{
+	int n = 0, count = max_x - x + 1;
+	while (n + 4 <= count && sameBlock(row + x + n, pattern))
+		n += 4;
+	while (n < count && samePixel(row[x + n], pattern.color))
+		++n;
+	return n;
+}
+
+//the same from x to the left, down to min_x
+static int matchLeft(const Color* row, int x, int min_x, const FillPattern& pattern)
+{
+	int n = 0, count = x - min_x + 1;
+	while (n + 4 <= count && sameBlock(row + x - n - 3, pattern))
+		n += 4;
+	while (n < count && samePixel(row[x - n], pattern.color))
+		++n;
+	return n;
+}
+
+//only the rows inside the clip
+#define PUSH_SPAN(_Y, _X0, _X1, _DY) { if ((_Y) + (_DY) >= clip.min_y && (_Y) + (_DY) <= clip.max_y) { FillSpan __S__ = { (_Y) + (_DY), (_X0), (_X1), (_DY) }; stack.push_back(__S__); } }
+
+void floodFill(const ImageView& target, const DrawClip& clip, int x, int y, const Color& color)
+{
+	if (x < clip.min_x || x > clip.max_x || y < clip.min_y || y > clip.max_y)
+		return;
+	FillPattern old(target.getPixel(x, y));
+	if (samePixel(old.color, color))
+		return; //nothing would change, and the filled pixels would be found again
+
+	//the row of the seed goes first, then the one above it
+	std::vector<FillSpan> stack;
+	PUSH_SPAN(y, x, x, 1);
+	PUSH_SPAN(y + 1, x, x, -1);
+	while (!stack.empty())
+	{
+		FillSpan s = stack.back();
+		stack.pop_back();
+		Color* row = target.getRow(s.y);
+
+		int start;
+		x = s.x0;
+		if (samePixel(row[x], old.color))
+		{
+			//the run goes on to the left of the span, what is beyond it can lead back to the row it came from
+			start = x - matchLeft(row, x, clip.min_x, old) + 1;
+			if (start < s.x0)
+				PUSH_SPAN(s.y, start, s.x0 - 1, -s.dy);
+		}
+		else
+		{
+			for (++x; x <= s.x1 && !samePixel(row[x], old.color); ++x);
+			start = x;
+		}
+
+		//every run of the region that touches the span
+		while (x <= s.x1)
+		{
+			x += matchRight(row, x, clip.max_x, old);
+			fillPixels(row + start, x - start, color);
+			PUSH_SPAN(s.y, start, x - 1, s.dy);
+			if (x > s.x1 + 1)
+				PUSH_SPAN(s.y, s.x1 + 1, x - 1, -s.dy);
+
+			for (++x; x <= s.x1 && !samePixel(row[x], old.color); ++x);
+			start = x;
+		}
+	}
+}
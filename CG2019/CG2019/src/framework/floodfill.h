@@ -0,0 +1,16 @@
+/*  Flood fill: paints the region of pixels of the same color around a seed (4 neighbours).
+	It works with runs of pixels instead of single pixels: every row of the region is found as a run, filled with
+	fillPixels, and the parts of the rows above and below it that still have to be checked are pushed as spans to an
+	explicit stack (no recursion, so big regions don't overflow the stack). The runs are found comparing 4 pixels at a
+	time as three 32 bit words.
+*/
+
+#ifndef FLOODFILL_H
+#define FLOODFILL_H
+
+#include "image.h"
+
+//fills the region that contains x,y with color, only inside the clip rectangle
+void floodFill(const ImageView& target, const DrawClip& clip, int x, int y, const Color& color);
+
+#endif
@@ -1,52 +1,142 @@
 #include "image.h"
+#include "resample.h"
+#include "blitter.h"
+#include "conics.h"
+#include "floodfill.h"
 
 
+//malloc with room to move the start to the next multiple of the alignment, the pointer to free is kept just before it
+void* alignedAlloc(size_t size)
+{
+	void* block = malloc(size + IMAGE_ALIGNMENT + sizeof(void*));
+	if (!block)
+		return NULL;
+	size_t start = ((size_t)block + sizeof(void*) + IMAGE_ALIGNMENT - 1) & ~(size_t)(IMAGE_ALIGNMENT - 1);
+	((void**)start)[-1] = block;
+	return (void*)start;
+}
+
+void alignedFree(void* data)
+{
+	if (data)
+		free(((void**)data)[-1]);
+}
+
+//16 pixels are 48 bytes, three 16 byte stores
+#define FILL_BLOCK 16
+
+void fillPixels(Color* pixels, unsigned int count, const Color& c)
+{
+	if (c.r == c.g && c.g == c.b)
+	{
+		memset((void*)pixels, c.r, count * sizeof(Color));
+		return;
+	}
+
+	Color block[FILL_BLOCK];
+	for (unsigned int i = 0; i < FILL_BLOCK; ++i)
+		block[i] = c;
+	for (; count >= FILL_BLOCK; count -= FILL_BLOCK, pixels += FILL_BLOCK)
+		memcpy(pixels, block, sizeof(block));
+	for (unsigned int i = 0; i < count; ++i)
+		pixels[i] = c;
+}
+
+ImageView ImageView::getArea(unsigned int x, unsigned int y, unsigned int width, unsigned int height) const
+{
+	if (x >= this->width || y >= this->height)
+		return ImageView();
+	if (width > this->width - x) width = this->width - x;
+	if (height > this->height - y) height = this->height - y;
+	return ImageView(pixels + y * stride + x, width, height, stride);
+}
+
 Image::Image() {
 	width = 0; height = 0;
 	pixels = NULL;
+	resetClipRect();
 }
 
 Image::Image(unsigned int width, unsigned int height)
 {
 	this->width = width;
 	this->height = height;
-	pixels = new Color[width*height];
-	memset(pixels, 0, width * height * sizeof(Color));
+	pixels = allocatePixels<Color>(width*height);
+	memset((void*)pixels, 0, width * height * sizeof(Color));
+	resetClipRect();
 }
 
 //copy constructor
 Image::Image(const Image& c) {
 	pixels = NULL;
+	resetClipRect();
 
 	width = c.width;
 	height = c.height;
 	if(c.pixels)
 	{
-		pixels = new Color[width*height];
+		pixels = allocatePixels<Color>(width*height);
 		memcpy(pixels, c.pixels, width*height*sizeof(Color));
 	}
 }
 
+//move constructor, no pixel is copied
+Image::Image(Image&& c)
+{
+	width = c.width;
+	height = c.height;
+	pixels = c.pixels;
+	resetClipRect();
+	c.width = c.height = 0;
+	c.pixels = NULL;
+}
+
+Image::Image(const ImageView& view)
+{
+	width = view.width;
+	height = view.height;
+	pixels = allocatePixels<Color>(width*height);
+	for(unsigned int y = 0; y < height; ++y)
+		memcpy(pixels + y * width, view.getRow(y), width * sizeof(Color));
+	resetClipRect();
+}
+
 //assign operator
 Image& Image::operator = (const Image& c)
 {
-	if(pixels) delete pixels;
+	if (this == &c)
+		return *this;
+	freePixels(pixels);
 	pixels = NULL;
+	resetClipRect();
 
 	width = c.width;
 	height = c.height;
 	if(c.pixels)
 	{
-		pixels = new Color[width*height*sizeof(Color)];
+		pixels = allocatePixels<Color>(width*height);
 		memcpy(pixels, c.pixels, width*height*sizeof(Color));
 	}
 	return *this;
 }
 
+Image& Image::operator = (Image&& c)
+{
+	if (this == &c)
+		return *this;
+	freePixels(pixels);
+	width = c.width;
+	height = c.height;
+	pixels = c.pixels;
+	resetClipRect();
+	c.width = c.height = 0;
+	c.pixels = NULL;
+	return *this;
+}
+
 Image::~Image()
 {
-	if(pixels) 
-		delete pixels;
+	freePixels(pixels);
 }
 
 
@@ -54,47 +144,55 @@ Image::~Image()
 //change image size (the old one will remain in the top-left corner)
 void Image::resize(unsigned int width, unsigned int height)
 {
-	Color* new_pixels = new Color[width*height];
+	Color* new_pixels = allocatePixels<Color>(width*height);
+	memset((void*)new_pixels, 0, width * height * sizeof(Color));
 	unsigned int min_width = this->width > width ? width : this->width;
 	unsigned int min_height = this->height > height ? height : this->height;
 
-	for(unsigned int x = 0; x < min_width; ++x)
-		for(unsigned int y = 0; y < min_height; ++y)
-			new_pixels[ y * width + x ] = getPixel(x,y);
+	for(unsigned int y = 0; y < min_height; ++y)
+		memcpy(new_pixels + y * width, pixels + y * this->width, min_width * sizeof(Color));
 
-	delete pixels;
+	freePixels(pixels);
 	this->width = width;
 	this->height = height;
 	pixels = new_pixels;
 }
 
-//change image size and scale the content
-void Image::scale(unsigned int width, unsigned int height)
+//change image size and scale the content with the filter
+void Image::scale(unsigned int width, unsigned int height, ResampleFilter filter)
 {
-	Color* new_pixels = new Color[width*height];
-
-	for(unsigned int x = 0; x < width; ++x)
-		for(unsigned int y = 0; y < height; ++y)
-			new_pixels[ y * width + x ] = getPixel((unsigned int)(this->width * (x / (float)width)), (unsigned int)(this->height * (y / (float)height)) );
+	Image result(width, height);
+	resample(getView(), result.getView(), filter);
 
-	delete pixels;
+	freePixels(pixels);
 	this->width = width;
 	this->height = height;
-	pixels = new_pixels;
+	pixels = result.pixels;
+	result.pixels = NULL;
+}
+
+ImageView Image::getView(unsigned int x, unsigned int y, unsigned int width, unsigned int height) const
+{
+	return ImageView(pixels, this->width, this->height, this->width).getArea(x, y, width, height);
 }
 
 Image Image::getArea(unsigned int start_x, unsigned int start_y, unsigned int width, unsigned int height)
 {
 	Image result(width, height);
-	for(unsigned int x = 0; x < width; ++x)
-		for(unsigned int y = 0; y < height; ++y)
-		{
-			if( (x + start_x) < this->width && (y + start_y) < this->height) 
-				result.setPixel( x, y, getPixel(x + start_x,y + start_y) );
-		}
+	getArea(start_x, start_y, width, height, result);
 	return result;
 }
 
+//the pixels outside of this image are left as they were in result
+void Image::getArea(unsigned int start_x, unsigned int start_y, unsigned int width, unsigned int height, Image& result) const
+{
+	if (result.width != width || result.height != height)
+		result.resize(width, height);
+	ImageView area = getView(start_x, start_y, width, height);
+	for(unsigned int y = 0; y < area.height; ++y)
+		memcpy(result.pixels + y * width, area.getRow(y), area.width * sizeof(Color));
+}
+
 void Image::flipX()
 {
 	for(unsigned int x = 0; x < width * 0.5; ++x)
@@ -164,7 +262,7 @@ bool Image::loadTGA(const char* filename)
 	if (tgainfo->data == NULL || fread(tgainfo->data, 1, imageSize, file) != imageSize)
 	{
 		if (tgainfo->data != NULL)
-			delete tgainfo->data;
+			delete[] tgainfo->data;
             
 		fclose(file);
 		delete tgainfo;
@@ -174,12 +272,11 @@ bool Image::loadTGA(const char* filename)
 	fclose(file);
 
 	//save info in image
-	if(pixels)
-		delete pixels;
+	freePixels(pixels);
 
 	width = tgainfo->width;
 	height = tgainfo->height;
-	pixels = new Color[width*height];
+	pixels = allocatePixels<Color>(width*height);
 
 	//convert to float all pixels
 	for(unsigned int y = 0; y < height; ++y)
@@ -189,7 +286,7 @@ bool Image::loadTGA(const char* filename)
 			this->setPixel(x , height - y - 1, Color( tgainfo->data[pos+2], tgainfo->data[pos+1], tgainfo->data[pos]) );
 		}
 
-	delete tgainfo->data;
+	delete[] tgainfo->data;
 	delete tgainfo;
 
 	return true;
@@ -234,205 +331,165 @@ bool Image::saveTGA(const char* filename)
 
 	fwrite(bytes, 1, width*height*3, file);
 	fclose(file);
+	delete[] bytes;
 	return true;
 }
 
-#ifndef IGNORE_LAMBDAS
-
-//you can apply and algorithm for two images and store the result in the first one
-//forEachPixel( img, img2, [](Color a, Color b) { return a + b; } );
-template <typename F>
-void forEachPixel(Image& img, const Image& img2, F f) {
-	for(unsigned int pos = 0; pos < img.width * img.height; ++pos)
-		img.pixels[pos] = f( img.pixels[pos], img2.pixels[pos] );
-}
-
-#endif
-
 
 /* my stuff */
 
-void Image::drawImage(const Image& img, unsigned int x, unsigned int y, unsigned int w, unsigned int h)
+void ImageView::fill(const Color& c) const
 {
-	if (w || h)
+	if (stride == width)
 	{
-		Image img2 = img;
-		img2.scale(w, h);
-		drawImage(img2, x, y, 0, 0);
+		fillPixels(pixels, width * height, c);
+		return;
 	}
-	else
-	{
-		unsigned int w = std::min(this->width - x, img.width);
-		unsigned int h = std::min(this->height - y, img.height);
+	for (unsigned int y = 0; y < height; ++y)
+		fillPixels(getRow(y), width, c);
+}
 
-		for (int i = x; i < w; ++i)
-			for (int j = y; j < h; ++j)
-				pixels[j * width + i] = img.pixels[j * img.width + i];
-	}
+//w and h stretch the image (0 keeps its size), see blit for more options
+void ImageView::drawImage(const ImageView& img, unsigned int x, unsigned int y, unsigned int w, unsigned int h, ResampleFilter filter) const
+{
+	BlitOptions options;
+	options.filter = filter;
+	blit(*this, img, (int)x, (int)y, w, h, options);
 }
 
 #define SGN(_F) (_F < 0 ? -1 : 1)
-#define DRAW_POINT(_X, _Y, _Color) this->pixels[(_Y) * this->width + (_X)] = (_Color)
 #define SWAP(a, b) { int __AUX__ = (a); (a) = (b); (b) = __AUX__; }
 
-void Image::drawLineDDL(int x0, int y0, int x1, int y1, const Color& color)
+DrawClip Image::getDrawClip() const
 {
-	float dx = static_cast<float>(x1 - x0);
-	float dy = static_cast<float>(y1 - y0);
-	float d = std::abs(dx) >= std::abs(dy) ? std::abs(dx) : std::abs(dy);
-	float vx = dx / d;
-	float vy = dy / d;
-	float x = x0 + SGN(x0) * 0.5f;
-	float y = y0 + SGN(y0) * 0.5f;
-
-	for (int i = 0; i <= d; ++i)
-	{
-		DRAW_POINT(static_cast<int>(std::floorf(x)), static_cast<int>(std::floorf(y)), color);
-		x += vx;
-		y += vy;
-	}
-
+	DrawClip clip;
+	clip.min_x = std::max(clip_min_x, 0);
+	clip.min_y = std::max(clip_min_y, 0);
+	clip.max_x = std::min(clip_max_x, static_cast<int>(width) - 1);
+	clip.max_y = std::min(clip_max_y, static_cast<int>(height) - 1);
+	return clip;
 }
 
-void Image::drawLineBresenham(int x0, int y0, int x1, int y1, const Color& color)
+static DrawClip getViewClip(const ImageView& view)
 {
-	int dx = std::abs(x1 - x0);
-	int dy = std::abs(y1 - y0);
-	int x, y, inc_H, inc_E, inc_NE, d;
-	if (dx > dy)
-	{
-		if (x0 > x1)
-		{
-			SWAP(x0, x1);
-			SWAP(y0, y1);
-		}
+	DrawClip clip = { 0, 0, static_cast<int>(view.width) - 1, static_cast<int>(view.height) - 1 };
+	return clip;
+}
 
-		x = x0;
-		y = y0;
-		inc_H = y0 > y1 ? -1 : 1;
-		inc_E = 2 * dy;
-		inc_NE = 2 * (dy - dx);
-		d = 2 * dy - dx;
+//a coordinate of the pixels of a line at the step t: base + floor((a + t * b) / d), with |b| <= d so it moves one pixel
+//at most per step. Exact integers, the lines are clipped once with it and the loop doesn't check the pixels
+struct LineAxis
+{
+	long long base, a, b, d;
+};
 
-		DRAW_POINT(x, y, color);
-		while (x < x1)
-		{
-			if (d <= 0) //Choose E
-			{
-				d += inc_E;
-				x += 1;
-			}
-			else //Choose NE
-			{
-				d += inc_NE;
-				x += 1;
-				y += inc_H;
-			}
-			DRAW_POINT(x, y, color);
-		}
-	}
-	else
-	{
-		if (y0 > y1)
-		{
-			SWAP(x0, x1);
-			SWAP(y0, y1);
-		}
+static inline long long floorDiv(long long a, long long b)
+{
+	long long q = a / b;
+	if ((a % b != 0) && ((a < 0) != (b < 0)))
+		q--;
+	return q;
+}
 
-		x = x0;
-		y = y0;
-		inc_H = x0 > x1 ? -1 : 1;
-		inc_E = 2 * dx;
-		inc_NE = 2 * (dx - dy);
-		d = 2 * dx - dy;
+static inline long long ceilDiv(long long a, long long b) { return -floorDiv(-a, b); }
 
-		DRAW_POINT(x, y, color);
-		while (y < y1)
-		{
-			if (d <= 0) //Choose E
-			{
-				d += inc_E;
-				y += 1;
-			}
-			else //Choose NE
-			{
-				d += inc_NE;
-				y += 1;
-				x += inc_H;
-			}
-			DRAW_POINT(x, y, color);
-		}
+//limits [first, last] to the steps where the coordinate is inside [min, max]
+static void clipSteps(const LineAxis& axis, int min, int max, long long& first, long long& last)
+{
+	//min <= base + floor(n / d) <= max  <=>  lo <= n - a <= hi, with n = a + t * b
+	long long lo = (min - axis.base) * axis.d - axis.a;
+	long long hi = (max - axis.base + 1) * axis.d - 1 - axis.a;
+	if (axis.b == 0)
+	{
+		if (lo > 0 || hi < 0)
+			last = first - 1;
+		return;
 	}
+	long long from = axis.b > 0 ? ceilDiv(lo, axis.b) : ceilDiv(hi, axis.b);
+	long long to = axis.b > 0 ? floorDiv(hi, axis.b) : floorDiv(lo, axis.b);
+	if (from > first) first = from;
+	if (to < last) last = to;
 }
 
-void Image::drawCircle(int x, int y, int radius, const Color& color, bool fill)
+//draws the steps 0 to num_steps of the line, only the ones inside the clip
+static void drawLineSteps(const ImageView& target, const DrawClip& clip, const LineAxis& x_axis, const LineAxis& y_axis, long long num_steps, const Color& color)
 {
-	int dx, dy, v;
-	dx = 0;
-	dy = radius;
-	v = 1 - radius;
-
-	if (fill)
+	long long first = 0, last = num_steps;
+	clipSteps(x_axis, clip.min_x, clip.max_x, first, last);
+	clipSteps(y_axis, clip.min_y, clip.max_y, first, last);
+	if (first > last)
+		return;
+
+	long long nx = x_axis.a + first * x_axis.b, ny = y_axis.a + first * y_axis.b;
+	long long x = floorDiv(nx, x_axis.d), y = floorDiv(ny, y_axis.d);
+	long long rx = nx - x * x_axis.d, ry = ny - y * y_axis.d;
+	long long pixel = (y_axis.base + y) * target.stride + x_axis.base + x;
+	for (long long t = first; t <= last; ++t)
 	{
-		for (int i = -dx; i <= dx; ++i)
-		{
-			DRAW_POINT(x + i, y + dy, color);
-			DRAW_POINT(x + i, y - dy, color);
-		}
-		for (int i = -dy; i <= dy; ++i)
-		{
-			DRAW_POINT(x + i, y + dx, color);
-			DRAW_POINT(x + i, y - dx, color);
-		}
+		target.pixels[pixel] = color;
+		rx += x_axis.b;
+		if (rx >= x_axis.d) { rx -= x_axis.d; pixel++; }
+		else if (rx < 0) { rx += x_axis.d; pixel--; }
+		ry += y_axis.b;
+		if (ry >= y_axis.d) { ry -= y_axis.d; pixel += target.stride; }
+		else if (ry < 0) { ry += y_axis.d; pixel -= target.stride; }
 	}
-	else
+}
+
+//every coordinate starts half a pixel away from the point (toward the sign of the coordinate) and advances d/steps
+static void drawLineDDL(const ImageView& target, const DrawClip& clip, int x0, int y0, int x1, int y1, const Color& color)
+{
+	long long dx = (long long)x1 - x0, dy = (long long)y1 - y0;
+	long long steps = std::max(std::abs(dx), std::abs(dy));
+	long long d = 2 * std::max(steps, 1LL);
+	LineAxis x_axis = { x0, SGN(x0) * d / 2, 2 * dx, d };
+	LineAxis y_axis = { y0, SGN(y0) * d / 2, 2 * dy, d };
+	drawLineSteps(target, clip, x_axis, y_axis, steps, color);
+}
+
+//the minor coordinate advances at the steps where the midpoint decision (2 * dminor - dmajor, ...) chooses NE
+static void drawLineBresenham(const ImageView& target, const DrawClip& clip, int x0, int y0, int x1, int y1, const Color& color)
+{
+	long long dx = std::abs((long long)x1 - x0);
+	long long dy = std::abs((long long)y1 - y0);
+	bool steep = !(dx > dy);
+	if (steep ? y0 > y1 : x0 > x1)
 	{
-		DRAW_POINT(x + dx, y + dy, color);
-		DRAW_POINT(x - dx, y - dy, color);
-		DRAW_POINT(x - dx, y + dy, color);
-		DRAW_POINT(x + dx, y - dy, color);
-		DRAW_POINT(x + dy, y + dx, color);
-		DRAW_POINT(x - dy, y - dx, color);
-		DRAW_POINT(x - dy, y + dx, color);
-		DRAW_POINT(x + dy, y - dx, color);
+		SWAP(x0, x1);
+		SWAP(y0, y1);
 	}
-	while (dy >= dx)
-	{
-		if (v < 0)
-		{
-			v += 2 * dx + 3;
-			++dx;
-		}
-		else
-		{
-			v += 2 * (dx - dy) + 5;
-			++dx;
-			--dy;
-		}
 
-		if (fill)
-		{
-			for (int i = -dx; i <= dx; ++i)
-			{
-				DRAW_POINT(x + i, y + dy, color);
-				DRAW_POINT(x + i, y - dy, color);
-			}
-			for (int i = -dy; i <= dy; ++i)
-			{
-				DRAW_POINT(x + i, y + dx, color);
-				DRAW_POINT(x + i, y - dx, color);
-			}
-		}
-		else
-		{
-			DRAW_POINT(x + dx, y + dy, color);
-			DRAW_POINT(x - dx, y - dy, color);
-			DRAW_POINT(x - dx, y + dy, color);
-			DRAW_POINT(x + dx, y - dy, color);
-			DRAW_POINT(x + dy, y + dx, color);
-			DRAW_POINT(x - dy, y - dx, color);
-			DRAW_POINT(x - dy, y + dx, color);
-			DRAW_POINT(x + dy, y - dx, color); 
-		}
-	}
+	long long major = steep ? dy : dx, minor = steep ? dx : dy;
+	int minor0 = steep ? x0 : y0;
+	bool minor_down = steep ? x0 > x1 : y0 > y1;
+
+	//minor0 +- floor((major - 1 + t * 2 * minor) / (2 * major))
+	LineAxis major_axis = { steep ? y0 : x0, 0, 1, 1 };
+	LineAxis minor_axis = { minor0, major - 1, 2 * minor, 2 * major };
+	if (!major)
+		minor_axis.a = 0, minor_axis.d = 1; //a single point
+	else if (minor_down)
+		minor_axis.a = major, minor_axis.b = -2 * minor; //-floor(n / d) is floor((d - 1 - n) / d)
+
+	if (steep)
+		drawLineSteps(target, clip, minor_axis, major_axis, major, color);
+	else
+		drawLineSteps(target, clip, major_axis, minor_axis, major, color);
 }
+
+void ImageView::drawLineDDL(int x0, int y0, int x1, int y1, const Color& color) const { ::drawLineDDL(*this, getViewClip(*this), x0, y0, x1, y1, color); }
+void ImageView::drawLineBresenham(int x0, int y0, int x1, int y1, const Color& color) const { ::drawLineBresenham(*this, getViewClip(*this), x0, y0, x1, y1, color); }
+void ImageView::drawCircle(int x, int y, int radius, const Color& color, bool fill) const { ::drawCircle(*this, getViewClip(*this), x, y, radius, color, fill); }
+void ImageView::drawEllipse(int x, int y, int radius_x, int radius_y, const Color& color, bool fill) const { ::drawEllipse(*this, getViewClip(*this), x, y, radius_x, radius_y, color, fill); }
+void ImageView::drawArc(int x, int y, int radius, float start_angle, float end_angle, const Color& color, bool fill) const { ::drawArc(*this, getViewClip(*this), x, y, radius, start_angle, end_angle, color, fill); }
+void ImageView::drawRing(int x, int y, int inner_radius, int outer_radius, const Color& color) const { ::drawRing(*this, getViewClip(*this), x, y, inner_radius, outer_radius, color); }
+void ImageView::floodFill(int x, int y, const Color& color) const { ::floodFill(*this, getViewClip(*this), x, y, color); }
+
+//the clip rectangle of the image is used instead of its bounds
+void Image::drawLineDDL(int x0, int y0, int x1, int y1, const Color& color) { ::drawLineDDL(getView(), getDrawClip(), x0, y0, x1, y1, color); }
+void Image::drawLineBresenham(int x0, int y0, int x1, int y1, const Color& color) { ::drawLineBresenham(getView(), getDrawClip(), x0, y0, x1, y1, color); }
+void Image::drawCircle(int x, int y, int radius, const Color& color, bool fill) { ::drawCircle(getView(), getDrawClip(), x, y, radius, color, fill); }
+void Image::drawEllipse(int x, int y, int radius_x, int radius_y, const Color& color, bool fill) { ::drawEllipse(getView(), getDrawClip(), x, y, radius_x, radius_y, color, fill); }
+void Image::drawArc(int x, int y, int radius, float start_angle, float end_angle, const Color& color, bool fill) { ::drawArc(getView(), getDrawClip(), x, y, radius, start_angle, end_angle, color, fill); }
+void Image::drawRing(int x, int y, int inner_radius, int outer_radius, const Color& color) { ::drawRing(getView(), getDrawClip(), x, y, inner_radius, outer_radius, color); }
+void Image::floodFill(int x, int y, const Color& color) { ::floodFill(getView(), getDrawClip(), x, y, color); }
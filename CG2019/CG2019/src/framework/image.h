@@ -10,12 +10,89 @@
 #include <string.h>
 #include <stdio.h>
 #include <iostream>
+#include <climits>
 #include "framework.h"
 
 //remove unsafe warnings
 #define _CRT_SECURE_NO_WARNINGS
 #pragma warning(disable:4996)
 
+//the pixels are allocated aligned to the cache lines, so the rows start at the beginning of a line
+#define IMAGE_ALIGNMENT 64
+void* alignedAlloc(size_t size);
+void alignedFree(void* data);
+template <typename T> T* allocatePixels(unsigned int count) { return (T*)alignedAlloc(count * sizeof(T)); }
+inline void freePixels(void* pixels) { alignedFree(pixels); }
+
+//writes c in count pixels, with wide stores (memset when the three channels are equal)
+void fillPixels(Color* pixels, unsigned int count, const Color& c);
+
+//the filters to change the size of an image, see resample.h
+enum ResampleFilter
+{
+	RESAMPLE_NEAREST,
+	RESAMPLE_BILINEAR,
+	RESAMPLE_BICUBIC,	//Catmull-Rom, sharper than bilinear
+	RESAMPLE_LANCZOS	//3 lobes, the sharpest and the slowest
+};
+
+//a rectangle of pixels of an image, it doesn't own them (the image must outlive it and not be resized)
+//stride is the distance in pixels from the start of a row to the next one, so a part of an image is a view, not a copy
+class ImageView
+{
+public:
+	Color* pixels;
+	unsigned int width;
+	unsigned int height;
+	unsigned int stride;
+
+	ImageView() { pixels = NULL; width = height = stride = 0; }
+	ImageView(Color* pixels, unsigned int width, unsigned int height, unsigned int stride) { this->pixels = pixels; this->width = width; this->height = height; this->stride = stride; }
+
+	bool isEmpty() const { return !width || !height; }
+
+	Color* getRow(unsigned int y) const { return pixels + y * stride; }
+	Color getPixel(unsigned int x, unsigned int y) const { return pixels[ y * stride + x ]; }
+	Color& getPixelRef(unsigned int x, unsigned int y) const { return pixels[ y * stride + x ]; }
+	inline void setPixel(unsigned int x, unsigned int y, const Color& c) const { pixels[ y * stride + x ] = c; }
+
+	//a part of this view, clipped to it
+	ImageView getArea(unsigned int x, unsigned int y, unsigned int width, unsigned int height) const;
+
+	//fill the view with the color C
+	void fill(const Color& c) const;
+
+	#ifndef IGNORE_LAMBDAS
+
+	//same as Image::forEachPixel, only for the pixels of the view
+	template <typename F>
+	const ImageView& forEachPixel( F callback ) const
+	{
+		for(unsigned int y = 0; y < height; ++y)
+		{
+			Color* row = getRow(y);
+			for(unsigned int x = 0; x < width; ++x)
+				row[x] = callback(row[x]);
+		}
+		return *this;
+	}
+
+	#endif
+
+	//the draw functions of Image, the coordinates are relative to the view and the pixels outside of it are discarded
+	void drawImage(const ImageView& img, unsigned int x = 0, unsigned int y = 0, unsigned int w = 0, unsigned int h = 0, ResampleFilter filter = RESAMPLE_NEAREST) const;
+	void drawLineDDL(int x0, int y0, int x1, int y1, const Color& color) const;
+	void drawLineBresenham(int x0, int y0, int x1, int y1, const Color& color) const;
+	void drawCircle(int x, int y, int radius, const Color& color, bool fill) const;
+	void drawEllipse(int x, int y, int radius_x, int radius_y, const Color& color, bool fill) const;
+	void drawArc(int x, int y, int radius, float start_angle, float end_angle, const Color& color, bool fill) const;
+	void drawRing(int x, int y, int inner_radius, int outer_radius, const Color& color) const;
+	void floodFill(int x, int y, const Color& color) const;
+};
+
+//rectangle where the draw functions can write (corners inclusive), already inside the target
+struct DrawClip { int min_x, min_y, max_x, max_y; };
+
 //Class Image: to store a matrix of pixels
 class Image
 {
@@ -37,7 +114,10 @@ public:
 	Image();
 	Image(unsigned int width, unsigned int height);
 	Image(const Image& c);
+	Image(Image&& c); //takes the pixels of c, that ends empty
+	explicit Image(const ImageView& view); //copies the pixels of the view
 	Image& operator = (const Image& c); //assign operator
+	Image& operator = (Image&& c);
 
 	//destructor
 	~Image();
@@ -56,16 +136,21 @@ public:
 	inline void setPixelSafe(unsigned int x, unsigned int y, const Color& c) const { x = clamp(x, 0, width-1); y = clamp(y, 0, height-1); pixels[ y * width + x ] = c; }
 
 	void resize(unsigned int width, unsigned int height);
-	void scale(unsigned int width, unsigned int height);
+	void scale(unsigned int width, unsigned int height, ResampleFilter filter = RESAMPLE_BILINEAR);
 	
 	void flipY(); //flip the image top-down
 	void flipX(); //flip the image left-right
 
 	//fill the image with the color C
-	void fill(const Color& c) { for(unsigned int pos = 0; pos < width*height; ++pos) pixels[pos] = c; }
+	void fill(const Color& c) { getView().fill(c); }
+
+	//the pixels of the image (or a part of it) without copying them
+	ImageView getView() const { return getView(0, 0, width, height); }
+	ImageView getView(unsigned int x, unsigned int y, unsigned int width, unsigned int height) const;
 
 	//returns a new image with the area from (startx,starty) of size width,height
 	Image getArea(unsigned int start_x, unsigned int start_y, unsigned int width, unsigned int height);
+	void getArea(unsigned int start_x, unsigned int start_y, unsigned int width, unsigned int height, Image& result) const; //reuses the pixels of result
 
 	//save or load images from the hard drive
 	bool loadTGA(const char* filename);
@@ -90,7 +175,14 @@ public:
 
 	/* my stuff */
 
-	void drawImage(const Image& img, unsigned int x = 0, unsigned int y = 0, unsigned int w = 0, unsigned int h = 0);
+	//the draw functions only touch the pixels inside this rectangle (corners inclusive), by default the whole image
+	int clip_min_x, clip_min_y;
+	int clip_max_x, clip_max_y;
+	void setClipRect(int min_x, int min_y, int max_x, int max_y) { clip_min_x = min_x; clip_min_y = min_y; clip_max_x = max_x; clip_max_y = max_y; }
+	void resetClipRect() { setClipRect(0, 0, INT_MAX, INT_MAX); }
+
+	void drawImage(const Image& img, unsigned int x = 0, unsigned int y = 0, unsigned int w = 0, unsigned int h = 0, ResampleFilter filter = RESAMPLE_NEAREST) { getView().drawImage(img.getView(), x, y, w, h, filter); }
+	void drawImage(const ImageView& img, unsigned int x = 0, unsigned int y = 0, unsigned int w = 0, unsigned int h = 0, ResampleFilter filter = RESAMPLE_NEAREST) { getView().drawImage(img, x, y, w, h, filter); }
 
 	void drawLineDDL(int x0, int y0, int x1, int y1, const Color& color);
 
@@ -98,7 +190,30 @@ public:
 
 	void drawCircle(int x, int y, int radius, const Color& color, bool fill);
 
+	//more shapes, see conics.h
+	void drawEllipse(int x, int y, int radius_x, int radius_y, const Color& color, bool fill);
+	void drawArc(int x, int y, int radius, float start_angle, float end_angle, const Color& color, bool fill);
+	void drawRing(int x, int y, int inner_radius, int outer_radius, const Color& color);
+
+	//paints the region of the color of x,y that contains it, see floodfill.h
+	void floodFill(int x, int y, const Color& color);
+
+private:
+	//the clip rectangle limited to the image size, computed once per draw call
+	DrawClip getDrawClip() const;
 
 };
 
+#ifndef IGNORE_LAMBDAS
+
+//you can apply and algorithm for two images and store the result in the first one
+//forEachPixel( img, img2, [](Color a, Color b) { return a + b; } );
+template <typename F>
+void forEachPixel(Image& img, const Image& img2, F f) {
+	for(unsigned int pos = 0; pos < img.width * img.height; ++pos)
+		img.pixels[pos] = f( img.pixels[pos], img2.pixels[pos] );
+}
+
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "resample.h"
+#include <vector>
+#include <cmath>
+
+//the weights are fixed point with this many bits, they add up to RESAMPLE_ONE
+#define RESAMPLE_BITS 14
+#define RESAMPLE_ONE (1 << RESAMPLE_BITS)
+//the rows between the two passes keep this many bits below the byte, in 16 bits with room for the overshoot of the
+//sharp filters, so they are rounded and clamped only once at the end
+#define RESAMPLE_EXTRA_BITS 6
+#define RESAMPLE_ROW_SHIFT (RESAMPLE_BITS - RESAMPLE_EXTRA_BITS)
+#define RESAMPLE_FINAL_SHIFT (RESAMPLE_BITS + RESAMPLE_EXTRA_BITS)
+
+static float filterSupport(ResampleFilter filter)
+{
+	switch (filter)
+	{
+		case RESAMPLE_BILINEAR: return 1.0f;
+		case RESAMPLE_BICUBIC: return 2.0f;
+		case RESAMPLE_LANCZOS: return 3.0f;
+		default: return 0.5f;
+	}
+}
+
+static float filterWeight(ResampleFilter filter, float x)
+{
+	x = fabsf(x);
+	switch (filter)
+	{
+		case RESAMPLE_BILINEAR:
+			return x < 1.0f ? 1.0f - x : 0.0f;
+		case RESAMPLE_BICUBIC:
+			//Catmull-Rom (a = -0.5)
+			if (x < 1.0f)
+				return (1.5f * x - 2.5f) * x * x + 1.0f;
+			if (x < 2.0f)
+				return ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f;
+			return 0.0f;
+		case RESAMPLE_LANCZOS:
+			if (x < 1e-5f)
+				return 1.0f;
+			if (x < 3.0f)
+				return 3.0f * sinf((float)PI * x) * sinf((float)PI * x / 3.0f) / ((float)(PI * PI) * x * x);
+			return 0.0f;
+		default:
+			return 1.0f;
+	}
+}
+
+//for every destination pixel, the first source pixel that contributes to it, how many do and their weights (taps per pixel)
+struct ResampleTable
+{
+	std::vector<int> first;
+	std::vector<int> count;
+	std::vector<int> weights;
+	int taps;
+};
+
+//src_size is scaled to scaled_size, only dst_size pixels of the result are needed, from start
+static void computeTable(ResampleFilter filter, unsigned int src_size, unsigned int scaled_size, unsigned int start, unsigned int dst_size, ResampleTable& table)
+{
+	float ratio = src_size / (float)scaled_size;
+	float filter_scale = ratio > 1.0f ? ratio : 1.0f; //shrinking, the filter covers all the pixels that go to one
+	float radius = filterSupport(filter) * filter_scale;
+
+	table.taps = filter == RESAMPLE_NEAREST ? 1 : (int)ceilf(radius) * 2 + 1;
+	if (table.taps > (int)src_size)
+		table.taps = src_size;
+	table.first.resize(dst_size);
+	table.count.resize(dst_size);
+	table.weights.resize(dst_size * table.taps);
+	std::vector<float> weights(table.taps);
+
+	for (unsigned int i = 0; i < dst_size; ++i)
+	{
+		int* fixed = &table.weights[i * table.taps];
+		if (filter == RESAMPLE_NEAREST)
+		{
+			table.first[i] = (int)((unsigned long long)(start + i) * src_size / scaled_size);
+			table.count[i] = 1;
+			fixed[0] = RESAMPLE_ONE;
+			continue;
+		}
+
+		//position of the center of the pixel in the source
+		float center = (start + i + 0.5f) * ratio - 0.5f;
+		int first = (int)ceilf(center - radius);
+		int last = (int)floorf(center + radius);
+		if (first < 0) first = 0;
+		if (last > (int)src_size - 1) last = src_size - 1;
+		if (last - first + 1 > table.taps) last = first + table.taps - 1;
+
+		float total = 0;
+		for (int j = first; j <= last; ++j)
+		{
+			weights[j - first] = filterWeight(filter, (j - center) / filter_scale);
+			total += weights[j - first];
+		}
+		if (total <= 0)
+		{
+			//nothing around (only at the borders of tiny images), the closest pixel is used
+			first = (int)floorf(center + 0.5f);
+			first = last = first < 0 ? 0 : (first > (int)src_size - 1 ? src_size - 1 : first);
+			weights[0] = total = 1;
+		}
+
+		//rounding the weights loses some bits, what is missing goes to the biggest so they add up to one
+		int sum = 0, biggest = 0;
+		for (int j = 0; j <= last - first; ++j)
+		{
+			fixed[j] = (int)floorf(weights[j] / total * RESAMPLE_ONE + 0.5f);
+			sum += fixed[j];
+			if (fixed[j] > fixed[biggest])
+				biggest = j;
+		}
+		fixed[biggest] += RESAMPLE_ONE - sum;
+		table.first[i] = first;
+		table.count[i] = last - first + 1;
+	}
+}
+
+//result of the horizontal pass, not clamped
+static inline short toRowValue(int value)
+{
+	return (short)((value + (1 << (RESAMPLE_ROW_SHIFT - 1))) >> RESAMPLE_ROW_SHIFT);
+}
+
+//result of the vertical pass
+static inline unsigned char toByte(int value)
+{
+	value = (value + (1 << (RESAMPLE_FINAL_SHIFT - 1))) >> RESAMPLE_FINAL_SHIFT;
+	return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+void resample(const ImageView& src, unsigned int width, unsigned int height, unsigned int start_x, unsigned int start_y, ImageView dst, ResampleFilter filter)
+{
+	//dst can't go out of the scaled image
+	if (start_x >= width || start_y >= height)
+		return;
+	if (dst.width > width - start_x) dst.width = width - start_x;
+	if (dst.height > height - start_y) dst.height = height - start_y;
+	if (src.isEmpty() || dst.isEmpty())
+		return;
+
+	ResampleTable table_x, table_y;
+	computeTable(filter, src.width, width, start_x, dst.width, table_x);
+	computeTable(filter, src.height, height, start_y, dst.height, table_y);
+
+	if (filter == RESAMPLE_NEAREST)
+	{
+		//no filtering, every pixel is taken from its row
+		for (unsigned int y = 0; y < dst.height; ++y)
+		{
+			const Color* src_row = src.getRow(table_y.first[y]);
+			Color* dst_row = dst.getRow(y);
+			if (width == src.width && start_x == 0)
+				memcpy(dst_row, src_row, dst.width * sizeof(Color));
+			else
+				for (unsigned int x = 0; x < dst.width; ++x)
+					dst_row[x] = src_row[table_x.first[x]];
+		}
+		return;
+	}
+
+	//only the source rows used by the destination are scaled horizontally
+	int row_begin = table_y.first[0];
+	int row_end = table_y.first[dst.height - 1] + table_y.count[dst.height - 1];
+	for (unsigned int y = 0; y < dst.height; ++y)
+	{
+		if (table_y.first[y] < row_begin) row_begin = table_y.first[y];
+		if (table_y.first[y] + table_y.count[y] > row_end) row_end = table_y.first[y] + table_y.count[y];
+	}
+	unsigned int channels = dst.width * 3;
+	std::vector<short> rows((size_t)(row_end - row_begin) * channels);
+
+	//horizontal pass, from the source rows to rows of the destination width
+	for (int y = row_begin; y < row_end; ++y)
+	{
+		const Color* src_row = src.getRow(y);
+		short* row = &rows[(size_t)(y - row_begin) * channels];
+		for (unsigned int x = 0; x < dst.width; ++x)
+		{
+			const Color* pixel = src_row + table_x.first[x];
+			const int* weights = &table_x.weights[x * table_x.taps];
+			int r = 0, g = 0, b = 0;
+			for (int k = 0; k < table_x.count[x]; ++k)
+			{
+				r += pixel[k].r * weights[k];
+				g += pixel[k].g * weights[k];
+				b += pixel[k].b * weights[k];
+			}
+			row[x * 3] = toRowValue(r);
+			row[x * 3 + 1] = toRowValue(g);
+			row[x * 3 + 2] = toRowValue(b);
+		}
+	}
+
+	//vertical pass, every destination row is a weighted sum of whole rows, channel after channel
+	std::vector<int> sums(channels);
+	for (unsigned int y = 0; y < dst.height; ++y)
+	{
+		std::fill(sums.begin(), sums.end(), 0);
+		const int* weights = &table_y.weights[y * table_y.taps];
+		for (int k = 0; k < table_y.count[y]; ++k)
+		{
+			const short* row = &rows[(size_t)(table_y.first[y] + k - row_begin) * channels];
+			int weight = weights[k];
+			for (unsigned int i = 0; i < channels; ++i)
+				sums[i] += row[i] * weight;
+		}
+
+		unsigned char* bytes = (unsigned char*)dst.getRow(y);
+		for (unsigned int i = 0; i < channels; ++i)
+			bytes[i] = toByte(sums[i]);
+	}
+}
@@ -0,0 +1,20 @@
+/*  Resampling of images.
+	The filters are separable, so the image is scaled first along the rows and then along the columns. The weights of
+	every destination column and row are computed once per call (14 bits fixed point) and the loops go row after row
+	over the channels, so the compiler can vectorize them.
+	When the image shrinks the filter is widened, so every source pixel contributes and there is no aliasing.
+*/
+
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include "image.h"
+
+//scales src to width x height and writes in dst the part of the result that starts at x,y (dst sets the size of that part)
+//the views must not overlap
+void resample(const ImageView& src, unsigned int width, unsigned int height, unsigned int x, unsigned int y, ImageView dst, ResampleFilter filter);
+
+//scales src to the size of dst
+inline void resample(const ImageView& src, const ImageView& dst, ResampleFilter filter) { resample(src, dst.width, dst.height, 0, 0, dst, filter); }
+
+#endif
@@ -21,6 +21,7 @@
 #include "includes.h"
 #include "application.h"
 #include "image.h"
+#include "presenter.h"
 
 std::string getBinPath()
 {
@@ -115,6 +116,48 @@ SDL_Window* createWindow(const char* caption, int width, int height )
 }
 
 //The application main loop
+//when nothing changed the loop sleeps waiting for events, but wakes up after this time anyway (in ms)
+#define LOOP_IDLE_WAIT 100
+
+//returns false when the app must close, redraw is set when the window needs to be painted again
+static bool processEvent(Application* app, const SDL_Event& sdlEvent, bool& redraw)
+{
+	switch(sdlEvent.type)
+		{
+			case SDL_QUIT: return false; break; //EVENT for when the user clicks the [x] in the corner
+			case SDL_MOUSEBUTTONDOWN: //EXAMPLE OF sync mouse input
+				app->mouse_state |= SDL_BUTTON(sdlEvent.button.button);
+				app->onMouseButtonDown(sdlEvent.button);
+				break;
+			case SDL_MOUSEBUTTONUP:
+				app->mouse_state &= ~SDL_BUTTON(sdlEvent.button.button);
+				app->onMouseButtonUp(sdlEvent.button);
+				break;
+			case SDL_KEYDOWN: //EXAMPLE OF sync keyboard input
+				app->onKeyDown(sdlEvent.key);
+				break;
+			case SDL_KEYUP: //EXAMPLE OF sync keyboard input
+				app->onKeyUp(sdlEvent.key);
+				break;
+			case SDL_TEXTINPUT:
+				// you can read the ASCII character from sdlEvent.text.text 
+				break;
+			case SDL_WINDOWEVENT:
+				switch (sdlEvent.window.event) {
+					case SDL_WINDOWEVENT_RESIZED: //resize opengl context
+						std::cout << "window resize" << std::endl;
+						app->setWindowSize( sdlEvent.window.data1, sdlEvent.window.data2 );
+						redraw = true;
+						break;
+					case SDL_WINDOWEVENT_EXPOSED: //the window content was lost (uncovered, restored...)
+					case SDL_WINDOWEVENT_SIZE_CHANGED:
+						redraw = true;
+						break;
+				}
+		}
+	return true;
+}
+
 void launchLoop(Application* app)
 {
 	SDL_Event sdlEvent;
@@ -126,6 +169,8 @@ void launchLoop(Application* app)
 	app->mouse_position.set(x,y);
 
 	double start_time = SDL_GetTicks();
+	bool redraw = true; //the first frame is always rendered
+	bool idle = false;
 
 	//infinite loop
 	while (1)
@@ -133,50 +178,29 @@ void launchLoop(Application* app)
 		//read keyboard state and stored in keystate
 		app->keystate = SDL_GetKeyboardState(NULL);
 
-		//Render frame and send it to screen
-
+		//Render frame and send it to screen, only when the app has something new to show or the window needs it
+		if (redraw || app->needsRender())
+		{
 			// Clear the window and the depth buffer
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
 			//call render function
-			app->render( app->framebuffer );
+			app->render(app->framebuffer);
 
-			//send to GPU
-			sendFramebufferToScreen(&app->framebuffer);
+			//copy to GPU (only what changed, the texture keeps the rest)
+			sendFramebufferToScreen(&app->framebuffer, app->getUpdatedRects());
 			//swap between front buffer and back buffer to show it 
 			SDL_GL_SwapWindow(app->window);
+			redraw = false;
+		}
 
-		//read events from the system
+		//read events from the system, if the last frame didn't change anything sleep until some event arrives
+		if (idle && SDL_WaitEventTimeout(&sdlEvent, LOOP_IDLE_WAIT))
+			if (!processEvent(app, sdlEvent, redraw))
+				return;
 		while(SDL_PollEvent(&sdlEvent))
-		{
-			switch(sdlEvent.type)
-				{
-					case SDL_QUIT: return; break; //EVENT for when the user clicks the [x] in the corner
-					case SDL_MOUSEBUTTONDOWN: //EXAMPLE OF sync mouse input
-						app->mouse_state |= SDL_BUTTON(sdlEvent.button.button);
-						app->onMouseButtonDown(sdlEvent.button);
-						break;
-					case SDL_MOUSEBUTTONUP:
-						app->mouse_state &= ~SDL_BUTTON(sdlEvent.button.button);
-						app->onMouseButtonUp(sdlEvent.button);
-						break;
-					case SDL_KEYDOWN: //EXAMPLE OF sync keyboard input
-						app->onKeyDown(sdlEvent.key);
-						break;
-					case SDL_KEYUP: //EXAMPLE OF sync keyboard input
-						app->onKeyUp(sdlEvent.key);
-						break;
-					case SDL_TEXTINPUT:
-						// you can read the ASCII character from sdlEvent.text.text 
-						break;
-					case SDL_WINDOWEVENT:
-						switch (sdlEvent.window.event) {
-							case SDL_WINDOWEVENT_RESIZED: //resize opengl context
-								std::cout << "window resize" << std::endl;
-								app->setWindowSize( sdlEvent.window.data1, sdlEvent.window.data2 );
-								break;
-						}
-				}
-		}
+			if (!processEvent(app, sdlEvent, redraw))
+				return;
 
 		//get mouse position and delta
 		app->mouse_state = SDL_GetMouseState(&x,&y);
@@ -186,11 +210,16 @@ void launchLoop(Application* app)
 
 		//update logic
 		double now = SDL_GetTicks();
+		if (idle)
+			last_time = now; //the time sleeping doesn't count, or the first update after it would jump
 		double elapsed_time = (now - last_time) * 0.001; //0.001 converts from milliseconds to seconds
 		app->time = (now - start_time) * 0.001;
 		app->update(elapsed_time);
 		last_time = now;
 
+		//nothing to show after the update, the next iteration can wait for events
+		idle = !redraw && !app->needsRender();
+
 		//check errors in opengl only when working in debug
 		#ifdef _DEBUG
 			checkGLErrors();
@@ -200,8 +229,41 @@ void launchLoop(Application* app)
 	return;
 }
 
+//the texture and the pixel buffer live as long as the GL context
+static Presenter* getPresenter()
+{
+	static Presenter* presenter = NULL;
+	if (!presenter)
+	{
+		presenter = new Presenter();
+		presenter->init();
+	}
+	return presenter;
+}
+
 void sendFramebufferToScreen( Image* img )
 {
+	Presenter* presenter = getPresenter();
+	if (presenter->isSupported())
+	{
+		presenter->upload(*img);
+		presenter->draw();
+		return;
+	}
+
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1 );
 	glDrawPixels(img->width, img->height, GL_RGB, GL_UNSIGNED_BYTE, img->pixels);
 }
+
+void sendFramebufferToScreen( Image* img, const std::vector<Rect>& updated_rects )
+{
+	Presenter* presenter = getPresenter();
+	if (!presenter->isSupported())
+	{
+		sendFramebufferToScreen(img); //glDrawPixels always sends everything
+		return;
+	}
+
+	presenter->upload(*img, updated_rects.data(), updated_rects.size());
+	presenter->draw();
+}
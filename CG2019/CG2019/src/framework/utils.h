@@ -10,6 +10,7 @@
 //General functions **************
 class Application;
 class Image;
+class Rect;
 
 //check opengl errors
 bool checkGLErrors();
@@ -18,6 +19,7 @@ SDL_Window* createWindow(const char* caption, int width, int height);
 void launchLoop(Application* app);
 
 void sendFramebufferToScreen(Image* img);
+void sendFramebufferToScreen(Image* img, const std::vector<Rect>& updated_rects); //only the rects changed since the last call
 
 //fast random generator
 inline unsigned long frand(void) {          //period 2^96-1
@@ -0,0 +1,77 @@
+#include "allocator.h"
+
+Arena::Arena(size_t block_size)
+{
+	this->block_size = block_size;
+	current = 0;
+	offset = 0;
+}
+
+Arena::~Arena()
+{
+	for (unsigned int i = 0; i < blocks.size(); ++i)
+		alignedFree(blocks[i].data);
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+	//the blocks come from alignedAlloc, so the offsets aligned inside them are aligned in memory (up to IMAGE_ALIGNMENT)
+	while (current < blocks.size())
+	{
+		size_t start = (offset + alignment - 1) & ~(alignment - 1);
+		if (start + size <= blocks[current].size)
+		{
+			offset = start + size;
+			return blocks[current].data + start;
+		}
+		//the rest of this block is wasted until the next reset
+		current++;
+		offset = 0;
+	}
+
+	Block block;
+	block.size = size > block_size ? size : block_size;
+	block.data = (unsigned char*)alignedAlloc(block.size);
+	blocks.push_back(block);
+	current = (unsigned int)blocks.size() - 1;
+	offset = size;
+	return block.data;
+}
+
+void Arena::rollback(const Marker& marker)
+{
+	current = marker.block;
+	offset = marker.offset;
+}
+
+void Arena::reset()
+{
+	if (blocks.size() > 1)
+	{
+		size_t total = getCapacity();
+		for (unsigned int i = 0; i < blocks.size(); ++i)
+			alignedFree(blocks[i].data);
+		blocks.clear();
+
+		Block block;
+		block.size = total;
+		block.data = (unsigned char*)alignedAlloc(total);
+		blocks.push_back(block);
+	}
+	current = 0;
+	offset = 0;
+}
+
+size_t Arena::getCapacity() const
+{
+	size_t total = 0;
+	for (unsigned int i = 0; i < blocks.size(); ++i)
+		total += blocks[i].size;
+	return total;
+}
+
+Arena& Arena::getFrame()
+{
+	static thread_local Arena arena;
+	return arena;
+}
@@ -0,0 +1,138 @@
+/*  Memory for the data that only lives during a frame (or while loading a file).
+	The Arena hands out memory by moving a pointer forward inside big blocks and frees everything at once, so the hot
+	paths don't go to the heap. After the first frames it has enough space and stops allocating.
+	The pools keep the images that are not used so the next one of the same size reuses the pixels.
+*/
+
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <vector>
+#include <cstddef>
+#include "image.h"
+
+#define ARENA_BLOCK_SIZE (1 << 20)
+
+class Arena
+{
+public:
+	//a position in the arena, rollback frees everything allocated after it
+	struct Marker
+	{
+		unsigned int block;
+		size_t offset;
+	};
+
+	Arena(size_t block_size = ARENA_BLOCK_SIZE);
+	~Arena();
+
+	//alignment must be a power of two, up to IMAGE_ALIGNMENT
+	void* allocate(size_t size, size_t alignment = 16);
+	//no constructors are called, only for plain data
+	template <typename T> T* allocateArray(size_t count) { return (T*)allocate(count * sizeof(T), alignof(T) > 16 ? alignof(T) : 16); }
+
+	Marker getMarker() const { Marker marker = { current, offset }; return marker; }
+	void rollback(const Marker& marker);
+
+	//frees everything, if it needed more than one block they are joined so the next frame fits in one
+	void reset();
+
+	size_t getCapacity() const;
+
+	//one for every thread, reset by the one that owns it at the start of the frame (or used with ArenaScope)
+	static Arena& getFrame();
+
+private:
+	struct Block
+	{
+		unsigned char* data;
+		size_t size;
+	};
+
+	std::vector<Block> blocks;
+	unsigned int current; //block being filled
+	size_t offset;		//used bytes of the current block
+	size_t block_size;
+
+	Arena(const Arena&);
+	Arena& operator = (const Arena&);
+};
+
+//frees what was allocated in the arena during its life
+class ArenaScope
+{
+public:
+	ArenaScope(Arena& arena) : arena(arena) { marker = arena.getMarker(); }
+	~ArenaScope() { arena.rollback(marker); }
+
+private:
+	Arena& arena;
+	Arena::Marker marker;
+};
+
+//keeps the released buffers to give them again when one of the same size and layout is asked
+template <class T>
+class BufferPool
+{
+public:
+	BufferPool(unsigned int max_free = 8) { this->max_free = max_free; }
+	~BufferPool() { clear(); }
+
+	//the content of the buffer is whatever it had before
+	T* acquire(unsigned int width, unsigned int height, PixelLayout layout = LINEAR)
+	{
+		for (unsigned int i = 0; i < free_buffers.size(); ++i)
+		{
+			T* buffer = free_buffers[i];
+			if (buffer->width == width && buffer->height == height && buffer->layout == layout)
+			{
+				free_buffers.erase(free_buffers.begin() + i);
+				return buffer;
+			}
+		}
+		return new T(width, height, layout);
+	}
+
+	//for the buffers made with other arguments, create(width, height) makes a new one (all the pool must be made the same way)
+	template <typename F>
+	T* acquire(unsigned int width, unsigned int height, F create)
+	{
+		for (unsigned int i = 0; i < free_buffers.size(); ++i)
+		{
+			T* buffer = free_buffers[i];
+			if (buffer->width == width && buffer->height == height)
+			{
+				free_buffers.erase(free_buffers.begin() + i);
+				return buffer;
+			}
+		}
+		return create(width, height);
+	}
+
+	void release(T* buffer)
+	{
+		//the oldest ones go away first
+		if (free_buffers.size() >= max_free)
+		{
+			delete free_buffers.front();
+			free_buffers.erase(free_buffers.begin());
+		}
+		free_buffers.push_back(buffer);
+	}
+
+	void clear()
+	{
+		for (unsigned int i = 0; i < free_buffers.size(); ++i)
+			delete free_buffers[i];
+		free_buffers.clear();
+	}
+
+private:
+	std::vector<T*> free_buffers;
+	unsigned int max_free;
+};
+
+typedef BufferPool<Image> ImagePool;
+typedef BufferPool<FloatImage> FloatImagePool;
+
+#endif
@@ -2,12 +2,42 @@
 #include "utils.h"
 #include "image.h"
 #include "mesh.h"
+#include "rasterizer.h"
+#include "sampler.h"
+#include "depthbuffer.h"
+#include "msaa.h"
+#include "transform.h"
+#include "jobs.h"
+#include "resample.h"
+#include "lines.h"
+#include "allocator.h"
 
 Mesh* mesh = NULL;
 Camera* camera = NULL;
 Image* texture = NULL;
+Sampler* sampler = NULL;
 
-FloatImage* z_buffer = nullptr;
+//the buffers renderScene uses for every size it renders at, so changing the scale or the window doesn't reallocate them
+BufferPool<DepthBuffer> z_buffers;
+BufferPool<MultisampleBuffer> msaa_buffers;
+bool use_msaa = false;
+bool wireframe = false;
+
+ImagePool scaled_framebuffers; //where the frames are rendered when the dynamic resolution lowers the scale, one per size
+
+VertexStream projected; //the vertices of the mesh in framebuffer coordinates, reused every frame
+
+//the triangles that passed the setup, so the bands of rows don't repeat it
+struct PreparedTriangle
+{
+	RasterTriangle tri;
+	unsigned int first_vertex;
+	float lod;
+};
+std::vector<PreparedTriangle> prepared;
+
+//the framebuffer is filled in bands of this many rows in parallel, multiple of the tile size so no tile is shared
+#define RASTER_BAND_ROWS (4 * PIXEL_TILE_SIZE)
 
 Mesh* cube = nullptr;
 
@@ -26,6 +56,12 @@ Application::Application(const char* caption, int width, int height)
 	this->keystate = SDL_GetKeyboardState(NULL);
 
 	framebuffer.resize(w, h);
+
+	this->scene_version = 0;
+	this->rendered_scene_version = 0;
+	this->rendered_camera_version = 0;
+	this->render_buffers = 1;
+	this->dynamic_resolution = false;
 }
 
 //Here we have already GL working, so we can create meshes and textures
@@ -36,6 +72,7 @@ void Application::init(void)
 
 	//here we create a global camera and set a position and projection properties
 	camera = new Camera();
+	camera->reversed_z = true; //must match the format of the z_buffer
 	camera->lookAt(Vector3(0, 10, 20), Vector3(0, 10, 0), Vector3(0, 1, 0)); //define eye,center,up
 	camera->perspective(60, window_width / (float)window_height, 0.1, 10000); //define fov,aspect,near,far
 
@@ -47,9 +84,10 @@ void Application::init(void)
 	//load the texture
 	texture = new Image();
 	texture->loadTGA("color.tga");
+	sampler = new Sampler(*texture, Sampler::TRILINEAR, Sampler::REPEAT);
 
-	//Init zbuffer
-	z_buffer = new FloatImage{ framebuffer.width, framebuffer.height };
+	//the framebuffer and the zbuffers are stored in 8x8 tiles so a triangle touches few cache lines
+	framebuffer.setLayout(TILED);
 
 
 	/* Drag input init */
@@ -61,103 +99,171 @@ void Application::init(void)
 	_dragCenterOrigin = {};
 }
 
-//this function fills the triangle by computing the bounding box of the triangle in screen space and using the barycentric interpolation
-//to check which pixels are inside the triangle. It is slow for big triangles, but faster for small triangles
-void fillTriangle(Image& colorbuffer, const Vector3& p0, const Vector3& p1, const Vector3& p2, const Vector2& uv0, const Vector2& uv1, const Vector2& uv2, Image* texture = NULL, FloatImage* zbuffer = NULL)
+//the uvs are linear in screen space, so the mipmap level is the same for all the triangle
+float computeTriangleLod(const Sampler* texture, const Vector3& p0, const Vector3& p1, const Vector3& p2, const Vector2& uv0, const Vector2& uv1, const Vector2& uv2)
 {
-	//compute triangle bounding box in screen space
-	Vector3 min_, max_;
-	computeMinMax(p0, p1, p2, min_, max_);
-	//clamp to screen area
-	min_ = clamp(min_, Vector3(0, 0, -1), Vector3(colorbuffer.width - 1, colorbuffer.height - 1, 1));
-	max_ = clamp(max_, Vector3(0, 0, -1), Vector3(colorbuffer.width - 1, colorbuffer.height - 1, 1));
-
-	//this avoids strange artifacts if the triangle is too big, just ignore this line
-	if ((min_.x == 0.0 && max_.x == colorbuffer.width - 1) || (min_.y == 0.0 && max_.y == colorbuffer.height - 1))
-		return;
-
-	//we must compute the barycentrinc interpolation coefficients
-	//we precompute some of them outside of loop to speed up (because they are constant)
-	Vector3 v0 = p1 - p0;
-	Vector3 v1 = p2 - p0;
-	float d00 = v0.dot(v0);
-	float d01 = v0.dot(v1);
-	float d11 = v1.dot(v1);
-	float denom = d00 * d11 - d01 * d01;
-
-	//loop all pixels inside bounding box
-	for (int x = min_.x; x < max_.x; ++x)
-	{
-#pragma omp parallel for //HACK: this is to execute loop iterations in parallel in multiple cores, should go faster (search openmp in google for more info)
-		for (int y = min_.y; y < max_.y; ++y)
-		{
-			Vector3 P(x, y, 0);
-			Vector3 v2 = P - p0; //P is the x,y of the pixel
-
-			//computing all weights of pixel P(x,y)
-			float d20 = v2.dot(v0);
-			float d21 = v2.dot(v1);
-			float v = (d11 * d20 - d01 * d21) / denom;
-			float w = (d00 * d21 - d01 * d20) / denom;
-			float u = 1.0 - v - w;
-			//check if pixel is inside or outside the triangle
-			if (u < 0 || u > 1 || v < 0 || v > 1 || w < 0 || w > 1 || denom == 0)
-				continue; //if it is outside, skip to next
-
-			//here add your code to test occlusions based on the Z of the vertices and the pixel
-			float depth = p0.z * u + p1.z * v + p2.z * w;
-			float& zbuf_depth = zbuffer->getPixelRef(x, y);
-			if (depth >= zbuf_depth)
-				continue;
-			zbuf_depth = depth;
+	Vector3 dw_dx, dw_dy;
+	computeWeightSteps(p0, p1, p2, dw_dx, dw_dy);
+	return texture->computeLod(
+		uv0.x * dw_dx.x + uv1.x * dw_dx.y + uv2.x * dw_dx.z, uv0.y * dw_dx.x + uv1.y * dw_dx.y + uv2.y * dw_dx.z,
+		uv0.x * dw_dy.x + uv1.x * dw_dy.y + uv2.x * dw_dy.z, uv0.y * dw_dy.x + uv1.y * dw_dy.y + uv2.y * dw_dy.z
+	);
+}
 
-			//here add your code to compute the color of the pixel
-			unsigned int tx = static_cast<unsigned int>((uv0.x * u + uv1.x * v + uv2.x * w) * texture->width);
-			unsigned int ty = static_cast<unsigned int>((uv0.y * u + uv1.y * v + uv2.y * w) * texture->height);
-			const Color& tcolor = texture->getPixelRef(tx, ty);
+//this function fills the rows from_y to to_y of a triangle already prepared with the fixed point rasterizer: the coverage
+//is computed with integer edge functions and the barycentric weights it gives are used to interpolate the depth and the
+//texture coordinates. Different rows can be filled at the same time from different threads
+void fillTriangle(Image& colorbuffer, const RasterTriangle& tri, int from_y, int to_y, const Vector3& p0, const Vector3& p1, const Vector3& p2, const Vector2& uv0, const Vector2& uv1, const Vector2& uv2, float lod, Sampler* texture, DepthBuffer* zbuffer)
+{
+	//only the pixels closer than what is in the zbuffer get here (the test is specialized for the zbuffer format)
+	traverseDepthTested(tri, from_y, to_y, *zbuffer, p0.z, p1.z, p2.z, [&](int x, int y, float u, float v, float w) {
+		//here add your code to compute the color of the pixel
+		float tu = uv0.x * u + uv1.x * v + uv2.x * w;
+		float tv = uv0.y * u + uv1.y * v + uv2.y * w;
+
+		//draw the pixels in the colorbuffer x,y position
+		colorbuffer.setPixel(x, y, texture->sample(tu, tv, lod));
+	});
+}
 
-			//draw the pixels in the colorbuffer x,y position
-			colorbuffer.setPixel(x, y, tcolor);
-		}
-	}
+#define isOutOfViewport(_Point, _W, _H) ((_Point).x < 0 || (_Point).x > (_W) || (_Point).y < 0 || (_Point).y > (_H))
+
+bool Application::needsRender()
+{
+	return scene_version != rendered_scene_version || camera->version != rendered_camera_version;
 }
 
-#define isOutOfClip(_Point) ((_Point).x < -1 || (_Point).x > 1 || (_Point).y < -1 || (_Point).y > 1)
+Application::FrameState Application::getFrameState()
+{
+	rendered_scene_version = scene_version;
+	rendered_camera_version = camera->version;
+
+	FrameState state;
+	state.camera = *camera;
+	state.use_msaa = use_msaa;
+	state.wireframe = wireframe;
+	state.resolution_scale = dynamic_resolution ? resolution.getScale() : 1.0f;
+	return state;
+}
 
 //render one frame
 void Application::render(Image& framebuffer)
 {
-	framebuffer.fill(Color(40, 45, 60 )); //clear
+	render(framebuffer, getFrameState());
+}
 
-	z_buffer->fill(FLT_MAX); //fill with maximum float value
+//only reads the state, the mesh and the texture, the other buffers are used only while rendering
+void Application::render(Image& framebuffer, const FrameState& state)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
 
+	//nothing allocated in the frame arena of this thread lives longer than a frame
+	Arena::getFrame().reset();
 
-	//for every point of the mesh (to draw triangles take three points each time and connect the points between them (1,2,3,   4,5,6,   ... )
-	for (int i = 0; i < mesh->vertices.size(); i += 3)
+	unsigned int width, height;
+	getScaledSize(framebuffer.width, framebuffer.height, state.resolution_scale, width, height);
+	if (width == framebuffer.width && height == framebuffer.height)
+		renderScene(framebuffer, state);
+	else
 	{
-		Vector3 p0 = camera->projectVector(mesh->vertices[i]);
-		Vector3 p1 = camera->projectVector(mesh->vertices[i + 1]);
-		Vector3 p2 = camera->projectVector(mesh->vertices[i + 2]);
+		//the scale moves between a few sizes, the pool keeps their images
+		Image* scaled_framebuffer = scaled_framebuffers.acquire(width, height, TILED);
+		renderScene(*scaled_framebuffer, state);
+		resample(*scaled_framebuffer, framebuffer, RESAMPLE_BILINEAR);
+		scaled_framebuffers.release(scaled_framebuffer);
+	}
 
-		if (isOutOfClip(p0) && isOutOfClip(p1) && isOutOfClip(p2))
-			continue;
+	//the time of the whole frame, scaling included, decides the resolution of the next ones
+	float time = (SDL_GetPerformanceCounter() - start) * 1000.0f / SDL_GetPerformanceFrequency();
+	resolution.addSample(time, state.resolution_scale);
+}
 
-		//convert from normalized (-1 to +1) to framebuffer coordinates (0,W)
-		p0.x = (p0.x + 1.f) * window_width / 2.f;
-		p0.y = (p0.y + 1.f) * window_height / 2.f;
+void Application::renderScene(Image& framebuffer, const FrameState& state)
+{
+	const bool use_msaa = state.use_msaa;
+	const float width = (float)framebuffer.width;
+	const float height = (float)framebuffer.height;
+
+	//the buffers of the size of the target, the anti-aliased mode renders in the msaa one and then resolves to the target (toggle with M)
+	DepthBuffer* z_buffer = NULL;
+	MultisampleBuffer* msaa_buffer = NULL;
+	if (use_msaa)
+		msaa_buffer = msaa_buffers.acquire(framebuffer.width, framebuffer.height, [&](unsigned int w, unsigned int h) { return new MultisampleBuffer(w, h, 4, state.camera.reversed_z); });
+	else
+		z_buffer = z_buffers.acquire(framebuffer.width, framebuffer.height, [](unsigned int w, unsigned int h) { return new DepthBuffer(w, h, DEPTH_FLOAT32_REVERSED, TILED); });
+
+	const Color background(40, 45, 60);
+	if (use_msaa)
+		msaa_buffer->clear(background);
+	else
+	{
+		framebuffer.fill(background); //clear
+		z_buffer->clear(); //fill with the far plane value
+	}
 
-		p1.x = (p1.x + 1.f) * window_width / 2.f;
-		p1.y = (p1.y + 1.f) * window_height / 2.f;
 
-		p2.x = (p2.x + 1.f) * window_width / 2.f;
-		p2.y = (p2.y + 1.f) * window_height / 2.f;
+	//project all the vertices at once, already converted from normalized (-1 to +1) to framebuffer coordinates (0,W)
+	projectPositions(state.camera.viewprojection_matrix, mesh->vertices.data(), (unsigned int)mesh->vertices.size(), width, height, projected);
+
+	//for every point of the mesh (to draw triangles take three points each time and connect the points between them (1,2,3,   4,5,6,   ... )
+	prepared.clear();
+	for (int i = 0; i < mesh->vertices.size(); i += 3)
+	{
+		Vector3 p0 = projected.getVector3(i);
+		Vector3 p1 = projected.getVector3(i + 1);
+		Vector3 p2 = projected.getVector3(i + 2);
+
+		if (isOutOfViewport(p0, width, height) && isOutOfViewport(p1, width, height) && isOutOfViewport(p2, width, height))
+			continue;
 
 		Vector2 uv0 = mesh->uvs[i];
 		Vector2 uv1 = mesh->uvs[i + 1];
 		Vector2 uv2 = mesh->uvs[i + 2];
 
-		fillTriangle(framebuffer, p0, p1, p2, uv0, uv1, uv2, texture, z_buffer);
+		if (use_msaa)
+		{
+			//coverage and depth per sample, but the texture is sampled once per pixel
+			float lod = computeTriangleLod(sampler, p0, p1, p2, uv0, uv1, uv2);
+			msaa_buffer->fillTriangle(p0, p1, p2, [&](float u, float v, float w) {
+				return sampler->sample(uv0.x * u + uv1.x * v + uv2.x * w, uv0.y * u + uv1.y * v + uv2.y * w, lod);
+			});
+			continue;
+		}
+
+		PreparedTriangle t;
+		if (!t.tri.setup(p0, p1, p2, framebuffer.width, framebuffer.height))
+			continue;
+		t.first_vertex = i;
+		t.lod = computeTriangleLod(sampler, p0, p1, p2, uv0, uv1, uv2);
+		prepared.push_back(t);
+	}
+
+	//every band draws the triangles in order, so the result is the same as drawing them one after the other
+	int num_bands = prepared.empty() ? 0 : (framebuffer.height + RASTER_BAND_ROWS - 1) / RASTER_BAND_ROWS;
+	JobSystem::get().parallelFor(0, num_bands, 1, [&](int first_band, int last_band) {
+		int from_y = first_band * RASTER_BAND_ROWS;
+		int to_y = last_band * RASTER_BAND_ROWS - 1;
+		for (unsigned int j = 0; j < prepared.size(); ++j)
+		{
+			const PreparedTriangle& t = prepared[j];
+			if (t.tri.max_y < from_y || t.tri.min_y > to_y)
+				continue;
+			unsigned int i = t.first_vertex;
+			fillTriangle(framebuffer, t.tri, from_y, to_y, projected.getVector3(i), projected.getVector3(i + 1), projected.getVector3(i + 2),
+				mesh->uvs[i], mesh->uvs[i + 1], mesh->uvs[i + 2], t.lod, sampler, z_buffer);
+		}
+	});
+
+	if (use_msaa)
+	{
+		msaa_buffer->resolve(framebuffer);
+		msaa_buffers.release(msaa_buffer);
 	}
+	else
+		z_buffers.release(z_buffer);
+
+	if (state.wireframe)
+		drawWireframe(framebuffer, projected, Color::WHITE);
 }
 
 //called after render
@@ -211,9 +317,8 @@ void Application::update(double seconds_elapsed)
 	}
 
 
-	//if we modify the camera fields, then update matrices
-	camera->updateViewMatrix();
-	camera->updateProjectionMatrix();
+	//if we modify the camera fields, then update matrices (only the ones that changed)
+	camera->update();
 }
 
 //keyboard press event 
@@ -221,7 +326,17 @@ void Application::onKeyDown( SDL_KeyboardEvent event )
 {
 	switch(event.keysym.sym)
 	{
-		case SDLK_ESCAPE: exit(0); break; //ESC key, kill the app
+		case SDLK_ESCAPE: //ESC key, close the app through the main loop so the render worker is stopped first
+		{
+			SDL_Event quit;
+			quit.type = SDL_QUIT;
+			SDL_PushEvent(&quit);
+			break;
+		}
+		case SDLK_m: use_msaa = !use_msaa; scene_version++; break; //toggle the anti-aliasing
+		case SDLK_p: render_buffers = render_buffers == 1 ? 2 : 1; break; //toggle rendering in a worker thread
+		case SDLK_w: wireframe = !wireframe; scene_version++; break; //toggle the wireframe overlay
+		case SDLK_r: dynamic_resolution = !dynamic_resolution; resolution.reset(); scene_version++; break; //toggle the dynamic resolution
 	}
 }
 
@@ -9,6 +9,7 @@
 #include "framework.h"
 #include "camera.h"
 #include "image.h"
+#include "resolution.h"
 
 class Application
 {
@@ -21,6 +22,27 @@ public:
 	float time;
 	Image framebuffer;
 
+	//the loop only calls render when something changed since the last frame
+	unsigned int scene_version; //increase it when something that is drawn changes (the camera has its own version)
+	unsigned int rendered_scene_version;
+	unsigned int rendered_camera_version;
+
+	//1 renders in the main thread, 2 or 3 renders in a worker thread (into that many framebuffers) while the main thread presents
+	unsigned int render_buffers;
+
+	//renders smaller when the frames take longer than the budget of the scaler, and scales up to the window
+	bool dynamic_resolution;
+	ResolutionScaler resolution;
+
+	//everything render reads that update can change, copied on the main thread so the worker never sees it changing
+	struct FrameState
+	{
+		Camera camera;
+		bool use_msaa;
+		bool wireframe; //draws the edges of the triangles over the frame
+		float resolution_scale; //1 renders directly in the framebuffer
+	};
+
 	//keyboard state
 	const Uint8* keystate;
 
@@ -35,7 +57,11 @@ public:
 	//main methods
 	void init( void );
 	void render( Image& framebuffer );
+	void render( Image& framebuffer, const FrameState& state ); //safe to call from another thread
+	void renderScene( Image& target, const FrameState& state ); //render at the size of target, ignoring the resolution scale
 	void update( double dt );
+	bool needsRender(); //true if the last rendered frame is out of date
+	FrameState getFrameState(); //the state for the next frame, it counts as rendered
 
 	//methods for events
 	void onKeyDown( SDL_KeyboardEvent event );
@@ -49,6 +75,7 @@ public:
 		this->window_width = width;
 		this->window_height = height;
 		framebuffer.resize(width, height);
+		scene_version++;
 	}
 
 	Vector2 getWindowSize()
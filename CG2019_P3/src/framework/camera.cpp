@@ -1,11 +1,15 @@
 #include "camera.h"
 
+static bool sameVector(const Vector3& a, const Vector3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+
 Camera::Camera()
 {
+	this->version = 0;
 	this->fov = 45;
 	this->aspect = 1;
 	this->near_plane = 0.01;
 	this->far_plane = 10000;
+	this->reversed_z = false;
 
 	eye = Vector3(0, 10, 20);
 	center = Vector3(0, 10, 0);
@@ -31,7 +35,62 @@ Camera::Camera()
 	projection_matrix.M[2][0] = 0.0; 	projection_matrix.M[2][1] = 0.0; projection_matrix.M[2][2] = -1.00000191; projection_matrix.M[2][3] = -1;
 	projection_matrix.M[3][0] = 0.0; 	projection_matrix.M[3][1] = 0.0; projection_matrix.M[3][2] = -0.0200000200;  projection_matrix.M[3][3] = 0.0;
 
+	updateDerivedData();
+}
+
+bool Camera::update()
+{
+	bool view_changed = !sameVector(eye, built_eye) || !sameVector(center, built_center) || !sameVector(up, built_up);
+	bool projection_changed = fov != built_fov || aspect != built_aspect || near_plane != built_near_plane || far_plane != built_far_plane || reversed_z != built_reversed_z;
+
+	//the projection first, updateViewMatrix also rebuilds the viewprojection
+	if (projection_changed)
+		updateProjectionMatrix();
+	if (view_changed)
+		updateViewMatrix();
+	return view_changed || projection_changed;
+}
+
+void Camera::updateDerivedData()
+{
 	viewprojection_matrix = view_matrix * projection_matrix;
+
+	inverse_viewprojection_matrix = viewprojection_matrix;
+	inverse_viewprojection_matrix.inverse();
+
+	//planes from the columns of the viewprojection (Gribb & Hartmann), the points are multiplied as rows
+	//so every clip coordinate is the dot of the point with a column
+	const float* m = viewprojection_matrix.m;
+	Vector4 cx(m[0], m[4], m[8], m[12]);
+	Vector4 cy(m[1], m[5], m[9], m[13]);
+	Vector4 cz(m[2], m[6], m[10], m[14]);
+	Vector4 cw(m[3], m[7], m[11], m[15]);
+	for (int i = 0; i < 4; ++i)
+	{
+		frustum_planes[0].v[i] = cw.v[i] + cx.v[i];	// -w <= x
+		frustum_planes[1].v[i] = cw.v[i] - cx.v[i];	//  x <= w
+		frustum_planes[2].v[i] = cw.v[i] + cy.v[i];	// -w <= y
+		frustum_planes[3].v[i] = cw.v[i] - cy.v[i];	//  y <= w
+		if (reversed_z)
+		{
+			frustum_planes[4].v[i] = cw.v[i] - cz.v[i];	// z <= w
+			frustum_planes[5].v[i] = cz.v[i];			// 0 <= z
+		}
+		else
+		{
+			frustum_planes[4].v[i] = cw.v[i] + cz.v[i];	// -w <= z
+			frustum_planes[5].v[i] = cw.v[i] - cz.v[i];	//  z <= w
+		}
+	}
+	for (int i = 0; i < 6; ++i)
+	{
+		Vector4& p = frustum_planes[i];
+		float len = sqrtf(p.x * p.x + p.y * p.y + p.z * p.z);
+		if (len > 0.0f)
+			p.set(p.x / len, p.y / len, p.z / len, p.w / len);
+	}
+
+	++version;
 }
 
 void Camera::updateViewMatrix()
@@ -52,9 +111,12 @@ void Camera::updateViewMatrix()
 
 	view_matrix.traslateLocal(-eye.x, -eye.y, -eye.z);
 
+	built_eye = eye;
+	built_center = center;
+	built_up = up;
 
 	//update the viewprojection_matrix
-	viewprojection_matrix = view_matrix * projection_matrix;
+	updateDerivedData();
 }
 
 void Camera::updateProjectionMatrix()
@@ -71,14 +133,28 @@ void Camera::updateProjectionMatrix()
 
 	projection_matrix.M[1][1] = f;
 
-	projection_matrix.M[2][2] = (far_plane + near_plane) / (near_plane - far_plane);
+	if (reversed_z)
+	{
+		//z goes from 1 (near) to 0 (far), the float precision is then spread along the whole range
+		projection_matrix.M[2][2] = near_plane / (far_plane - near_plane);
+		projection_matrix.M[3][2] = (far_plane * near_plane) / (far_plane - near_plane);
+	}
+	else
+	{
+		projection_matrix.M[2][2] = (far_plane + near_plane) / (near_plane - far_plane);
+		projection_matrix.M[3][2] = 2.f * ((far_plane * near_plane) / (near_plane - far_plane));
+	}
 	projection_matrix.M[2][3] = -1;
+	projection_matrix.M[3][3] = 0; //w must be -z, setIdentity left a 1 here
 
-	projection_matrix.M[3][2] = 2.f * ((far_plane * near_plane) / (near_plane - far_plane));
-
+	built_fov = fov;
+	built_aspect = aspect;
+	built_near_plane = near_plane;
+	built_far_plane = far_plane;
+	built_reversed_z = reversed_z;
 
 	//update the viewprojection_matrix
-	viewprojection_matrix = view_matrix * projection_matrix;
+	updateDerivedData();
 }
 
 Vector3 Camera::projectVector( Vector3 pos )
@@ -88,6 +164,23 @@ Vector3 Camera::projectVector( Vector3 pos )
 	return result.getVector3() / result.w;
 }
 
+Vector3 Camera::unprojectVector( Vector3 pos )
+{
+	Vector4 result = inverse_viewprojection_matrix * Vector4(pos.x, pos.y, pos.z, 1.0);
+	return result.getVector3() / result.w;
+}
+
+bool Camera::testSphereInFrustum( const Vector3& center, float radius ) const
+{
+	for (int i = 0; i < 6; ++i)
+	{
+		const Vector4& p = frustum_planes[i];
+		if (p.x * center.x + p.y * center.y + p.z * center.z + p.w < -radius)
+			return false;
+	}
+	return true;
+}
+
 void Camera::lookAt( Vector3 eye, Vector3 center, Vector3 up )
 {
 	this->eye = eye;
@@ -109,7 +202,7 @@ void Camera::perspective( float fov, float aspect, float near_plane, float far_p
 
 Matrix44 Camera::getViewProjectionMatrix()
 {
-	viewprojection_matrix = view_matrix * projection_matrix;
-	return viewprojection_matrix ;
+	update();
+	return viewprojection_matrix;
 }
 
@@ -15,22 +15,44 @@ public:
 	float aspect;
 	float near_plane;
 	float far_plane;
+	bool reversed_z; //projects the near plane to z=1 and the far plane to z=0 (for DEPTH_FLOAT32_REVERSED)
 
 	Matrix44 view_matrix;	
 	Matrix44 projection_matrix;
 	Matrix44 viewprojection_matrix;
 
+	//derived data, rebuilt together with the matrices
+	Matrix44 inverse_viewprojection_matrix;
+	Vector4 frustum_planes[6]; //left, right, bottom, top, near, far. Normalized (a,b,c,d), a*x+b*y+c*z+d >= 0 is inside
+	unsigned int version; //grows every time the matrices change, to know if something computed with them is still valid
+
 	Camera();
 
 	void lookAt( Vector3 eye, Vector3 center, Vector3 up );
 	void perspective( float fov, float aspect, float near_plane, float far_plane );
 
 	Vector3 projectVector( Vector3 pos );
+	Vector3 unprojectVector( Vector3 pos ); //from NDC back to world
+
+	//true if the sphere is (at least partially) inside the frustum
+	bool testSphereInFrustum( const Vector3& center, float radius ) const;
+
+	//rebuilds only the matrices whose fields changed since the last time, returns true if something changed
+	bool update();
 
+	//rebuild always
 	void updateViewMatrix();
 	void updateProjectionMatrix();
 
 	Matrix44 getViewProjectionMatrix();
+
+private:
+	//the fields used to build the current matrices
+	Vector3 built_eye, built_center, built_up;
+	float built_fov, built_aspect, built_near_plane, built_far_plane;
+	bool built_reversed_z;
+
+	void updateDerivedData();
 };
 
 
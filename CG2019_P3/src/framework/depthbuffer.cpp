@@ -0,0 +1,68 @@
+#include "depthbuffer.h"
+
+DepthBuffer::DepthBuffer()
+{
+	width = height = 0;
+	format = DEPTH_FLOAT32;
+	layout = LINEAR;
+	tiles_x = 0;
+	data = NULL;
+}
+
+DepthBuffer::DepthBuffer(unsigned int width, unsigned int height, DepthFormat format, PixelLayout layout)
+{
+	data = NULL;
+	create(width, height, format, layout);
+}
+
+DepthBuffer::~DepthBuffer()
+{
+	if (data)
+		delete[] data;
+}
+
+void DepthBuffer::create(unsigned int width, unsigned int height, DepthFormat format, PixelLayout layout)
+{
+	if (data)
+		delete[] data;
+
+	this->width = width;
+	this->height = height;
+	this->format = format;
+	this->layout = layout;
+	tiles_x = (width + PIXEL_TILE_MASK) >> PIXEL_TILE_BITS;
+	data = new unsigned char[pixelStorageSize(layout, width, height) * bytesPerPixel()];
+	clear();
+}
+
+template <DepthFormat FORMAT>
+static void clearData(DepthBuffer& depth, unsigned int size)
+{
+	typename DepthTraits<FORMAT>::Type* data = depth.getData<FORMAT>();
+	typename DepthTraits<FORMAT>::Type value = DepthTraits<FORMAT>::farValue();
+	for (unsigned int pos = 0; pos < size; ++pos)
+		data[pos] = value;
+}
+
+void DepthBuffer::clear()
+{
+	unsigned int size = pixelStorageSize(layout, width, height);
+	switch (format)
+	{
+		case DEPTH_FLOAT32: clearData<DEPTH_FLOAT32>(*this, size); break;
+		case DEPTH_UNORM16: clearData<DEPTH_UNORM16>(*this, size); break;
+		case DEPTH_UNORM24: clearData<DEPTH_UNORM24>(*this, size); break;
+		case DEPTH_FLOAT32_REVERSED: clearData<DEPTH_FLOAT32_REVERSED>(*this, size); break;
+	}
+}
+
+float DepthBuffer::getDepth(unsigned int x, unsigned int y) const
+{
+	unsigned int pos = index(x, y);
+	switch (format)
+	{
+		case DEPTH_UNORM16: return DepthTraits<DEPTH_UNORM16>::decode(reinterpret_cast<const unsigned short*>(data)[pos]);
+		case DEPTH_UNORM24: return DepthTraits<DEPTH_UNORM24>::decode(reinterpret_cast<const unsigned int*>(data)[pos]);
+		default: return reinterpret_cast<const float*>(data)[pos];
+	}
+}
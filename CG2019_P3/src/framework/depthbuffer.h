@@ -0,0 +1,133 @@
+/*  Depth buffer with selectable storage format for the software rasterizer.
+	The depth test is specialized for every format (a template per format), and the format is only
+	checked once per triangle, not once per pixel.
+*/
+
+#ifndef DEPTHBUFFER_H
+#define DEPTHBUFFER_H
+
+#include <cfloat>
+#include "framework.h"
+#include "image.h"
+#include "rasterizer.h"
+
+enum DepthFormat
+{
+	DEPTH_FLOAT32,			//NDC z (-1..1) as a float, smaller is closer
+	DEPTH_UNORM16,			//window z (0..1) in 16 bits, smaller is closer
+	DEPTH_UNORM24,			//window z (0..1) in 24 bits (stored in 32 bits words), smaller is closer
+	DEPTH_FLOAT32_REVERSED	//z (1 at the near plane, 0 at the far one) as a float, bigger is closer. Needs a camera with reversed_z
+};
+
+//per format encoding and comparison
+template <DepthFormat FORMAT> struct DepthTraits;
+
+template <> struct DepthTraits<DEPTH_FLOAT32>
+{
+	typedef float Type;
+	static Type farValue() { return FLT_MAX; }
+	static Type encode(float z) { return z; }
+	static float decode(Type d) { return d; }
+	static bool closer(Type a, Type b) { return a < b; }
+};
+
+template <> struct DepthTraits<DEPTH_UNORM16>
+{
+	typedef unsigned short Type;
+	static Type farValue() { return 0xFFFF; }
+	static Type encode(float z) { float d = z * 0.5f + 0.5f; return d <= 0.f ? 0 : (d >= 1.f ? 0xFFFF : static_cast<Type>(d * 65535.f + 0.5f)); }
+	static float decode(Type d) { return d / 65535.f * 2.f - 1.f; }
+	static bool closer(Type a, Type b) { return a < b; }
+};
+
+template <> struct DepthTraits<DEPTH_UNORM24>
+{
+	typedef unsigned int Type;
+	static Type farValue() { return 0xFFFFFF; }
+	static Type encode(float z) { float d = z * 0.5f + 0.5f; return d <= 0.f ? 0 : (d >= 1.f ? 0xFFFFFF : static_cast<Type>(d * 16777215.f + 0.5f)); }
+	static float decode(Type d) { return d / 16777215.f * 2.f - 1.f; }
+	static bool closer(Type a, Type b) { return a < b; }
+};
+
+template <> struct DepthTraits<DEPTH_FLOAT32_REVERSED>
+{
+	typedef float Type;
+	static Type farValue() { return 0.f; }
+	static Type encode(float z) { return z; }
+	static float decode(Type d) { return d; }
+	static bool closer(Type a, Type b) { return a > b; }
+};
+
+class DepthBuffer
+{
+public:
+	unsigned int width;
+	unsigned int height;
+	DepthFormat format;
+	PixelLayout layout;
+	unsigned int tiles_x; //blocks per row when the layout is TILED
+	unsigned char* data;
+
+	DepthBuffer();
+	DepthBuffer(unsigned int width, unsigned int height, DepthFormat format = DEPTH_FLOAT32, PixelLayout layout = LINEAR);
+	~DepthBuffer();
+
+	//changes the size or the format, the content is lost
+	void create(unsigned int width, unsigned int height, DepthFormat format, PixelLayout layout = LINEAR);
+	void resize(unsigned int width, unsigned int height) { create(width, height, format, layout); }
+
+	//bytes used by one pixel
+	unsigned int bytesPerPixel() const { return format == DEPTH_UNORM16 ? 2 : 4; }
+	unsigned int index(unsigned int x, unsigned int y) const { return pixelIndex(layout, width, tiles_x, x, y); }
+
+	//sets every pixel to the far plane
+	void clear();
+
+	//the stored depth (in the same space the format receives)
+	float getDepth(unsigned int x, unsigned int y) const;
+
+	template <DepthFormat FORMAT>
+	typename DepthTraits<FORMAT>::Type* getData() { return reinterpret_cast<typename DepthTraits<FORMAT>::Type*>(data); }
+
+private:
+	DepthBuffer(const DepthBuffer&);
+	DepthBuffer& operator = (const DepthBuffer&);
+};
+
+template <DepthFormat FORMAT, typename F>
+void _traverseDepthTested(const RasterTriangle& tri, int from_y, int to_y, DepthBuffer& depth, float z0, float z1, float z2, F fragment)
+{
+	typedef DepthTraits<FORMAT> Traits;
+	typename Traits::Type* data = depth.getData<FORMAT>();
+
+	tri.traverse(from_y, to_y, [&](int x, int y, float w0, float w1, float w2) {
+		typename Traits::Type z = Traits::encode(z0 * w0 + z1 * w1 + z2 * w2);
+		typename Traits::Type& stored = data[depth.index(x, y)];
+		if (Traits::closer(z, stored))
+		{
+			stored = z;
+			fragment(x, y, w0, w1, w2);
+		}
+	});
+}
+
+//calls fragment(x, y, w0, w1, w2) for the pixels of the triangle that pass the depth test, the depth is written before
+template <typename F>
+void traverseDepthTested(const RasterTriangle& tri, int from_y, int to_y, DepthBuffer& depth, float z0, float z1, float z2, F fragment)
+{
+	switch (depth.format)
+	{
+		case DEPTH_FLOAT32: _traverseDepthTested<DEPTH_FLOAT32>(tri, from_y, to_y, depth, z0, z1, z2, fragment); break;
+		case DEPTH_UNORM16: _traverseDepthTested<DEPTH_UNORM16>(tri, from_y, to_y, depth, z0, z1, z2, fragment); break;
+		case DEPTH_UNORM24: _traverseDepthTested<DEPTH_UNORM24>(tri, from_y, to_y, depth, z0, z1, z2, fragment); break;
+		case DEPTH_FLOAT32_REVERSED: _traverseDepthTested<DEPTH_FLOAT32_REVERSED>(tri, from_y, to_y, depth, z0, z1, z2, fragment); break;
+	}
+}
+
+template <typename F>
+void traverseDepthTested(const RasterTriangle& tri, DepthBuffer& depth, float z0, float z1, float z2, F fragment)
+{
+	traverseDepthTested(tri, tri.min_y, tri.max_y, depth, z0, z1, z2, fragment);
+}
+
+#endif
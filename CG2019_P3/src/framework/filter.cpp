@@ -0,0 +1,209 @@
+#include "filter.h"
+#include "allocator.h"
+#include "jobs.h"
+#include <cmath>
+
+//rows per job
+#define FILTER_GRAIN 32
+//the averages multiply by 1/size in fixed point, with 24 bits 255 * size * (2^24 / size) still fits in 32 bits
+#define FILTER_BITS 24
+
+static inline int clampRow(int y, int height)
+{
+	return y < 0 ? 0 : (y >= height ? height - 1 : y);
+}
+
+//copies the row with radius copies of its first pixel before it and of its last one after it
+static void padRow(const Color* row, unsigned int width, int radius, Color* padded)
+{
+	for (int i = 0; i < radius; ++i)
+	{
+		padded[i] = row[0];
+		padded[radius + width + i] = row[width - 1];
+	}
+	memcpy(padded + radius, row, width * sizeof(Color));
+}
+
+static void boxBlurPass(Image& img, int radius)
+{
+	const int width = img.width, height = img.height;
+	const unsigned int size = 2 * radius + 1;
+	const unsigned int inv_size = (1u << FILTER_BITS) / size;
+	const unsigned int half = 1u << (FILTER_BITS - 1);
+
+	Arena& arena = Arena::getFrame();
+	ArenaScope scope(arena);
+	Color* rows = arena.allocateArray<Color>((size_t)width * height);
+
+	//horizontal, the sum moves along the row adding the pixel that enters the window and removing the one that leaves it
+	JobSystem::get().parallelFor(0, height, FILTER_GRAIN, [&](int from, int to) {
+		Arena& job_arena = Arena::getFrame();
+		ArenaScope job_scope(job_arena);
+		Color* scratch = job_arena.allocateArray<Color>(width);
+		Color* padded = job_arena.allocateArray<Color>(width + 2 * radius);
+		for (int y = from; y < to; ++y)
+		{
+			padRow(img.readRow(y, scratch), width, radius, padded);
+			Color* row = rows + (size_t)y * width;
+			unsigned int r = 0, g = 0, b = 0;
+			for (unsigned int i = 0; i < size; ++i)
+			{
+				r += padded[i].r;
+				g += padded[i].g;
+				b += padded[i].b;
+			}
+			for (int x = 0; x < width; ++x)
+			{
+				row[x].r = (unsigned char)((r * inv_size + half) >> FILTER_BITS);
+				row[x].g = (unsigned char)((g * inv_size + half) >> FILTER_BITS);
+				row[x].b = (unsigned char)((b * inv_size + half) >> FILTER_BITS);
+				if (x + 1 < width)
+				{
+					const Color& in = padded[x + size];
+					const Color& out = padded[x];
+					r += in.r - out.r;
+					g += in.g - out.g;
+					b += in.b - out.b;
+				}
+			}
+		}
+	});
+
+	//vertical, the same with whole rows: one sum per channel of the row, every band of rows starts its own sums
+	int grain = (int)size > FILTER_GRAIN ? (int)size : FILTER_GRAIN;
+	JobSystem::get().parallelFor(0, height, grain, [&](int from, int to) {
+		Arena& job_arena = Arena::getFrame();
+		ArenaScope job_scope(job_arena);
+		const unsigned int channels = width * 3;
+		unsigned int* sums = job_arena.allocateArray<unsigned int>(channels);
+		Color* scratch = job_arena.allocateArray<Color>(width);
+		unsigned char* result = (unsigned char*)scratch;
+
+		memset(sums, 0, channels * sizeof(unsigned int));
+		for (int k = -radius; k <= radius; ++k)
+		{
+			const unsigned char* row = (const unsigned char*)(rows + (size_t)clampRow(from + k, height) * width);
+			for (unsigned int i = 0; i < channels; ++i)
+				sums[i] += row[i];
+		}
+
+		for (int y = from; y < to; ++y)
+		{
+			for (unsigned int i = 0; i < channels; ++i)
+				result[i] = (unsigned char)((sums[i] * inv_size + half) >> FILTER_BITS);
+			img.writeRow(y, scratch);
+
+			const unsigned char* in = (const unsigned char*)(rows + (size_t)clampRow(y + radius + 1, height) * width);
+			const unsigned char* out = (const unsigned char*)(rows + (size_t)clampRow(y - radius, height) * width);
+			for (unsigned int i = 0; i < channels; ++i)
+				sums[i] += in[i] - out[i];
+		}
+	});
+}
+
+void boxBlur(Image& img, int radius)
+{
+	if (radius <= 0 || !img.width || !img.height)
+		return;
+	boxBlurPass(img, radius);
+}
+
+void gaussianBlur(Image& img, float sigma)
+{
+	if (sigma <= 0 || !img.width || !img.height)
+		return;
+
+	//three boxes, the first ones of width wl and the rest of width wl + 2, with the variance of the gaussian
+	const int passes = 3;
+	float ideal = sqrtf(12.0f * sigma * sigma / passes + 1.0f);
+	int wl = (int)floorf(ideal);
+	if (wl % 2 == 0)
+		wl--;
+	int m = (int)floorf((12.0f * sigma * sigma - passes * wl * wl - 4.0f * passes * wl - 3.0f * passes) / (-4.0f * wl - 4.0f) + 0.5f);
+	for (int i = 0; i < passes; ++i)
+	{
+		int radius = ((i < m ? wl : wl + 2) - 1) / 2;
+		if (radius > 0)
+			boxBlurPass(img, radius);
+	}
+}
+
+void convolveSeparable(const Image& src, Image& dst, const float* kernel_x, int radius_x, const float* kernel_y, int radius_y, float bias)
+{
+	if (!src.width || !src.height)
+		return;
+	if (&dst != &src && (dst.width != src.width || dst.height != src.height))
+		dst = Image(src.width, src.height, src.layout);
+
+	const int width = src.width, height = src.height;
+	const unsigned int channels = width * 3;
+	Arena& arena = Arena::getFrame();
+	ArenaScope scope(arena);
+	float* rows = arena.allocateArray<float>((size_t)channels * height);
+
+	//horizontal, into floats so the negative weights are not lost before the vertical pass
+	JobSystem::get().parallelFor(0, height, FILTER_GRAIN, [&](int from, int to) {
+		Arena& job_arena = Arena::getFrame();
+		ArenaScope job_scope(job_arena);
+		Color* scratch = job_arena.allocateArray<Color>(width);
+		Color* padded = job_arena.allocateArray<Color>(width + 2 * radius_x);
+		for (int y = from; y < to; ++y)
+		{
+			padRow(src.readRow(y, scratch), width, radius_x, padded);
+			float* row = rows + (size_t)y * channels;
+			for (int x = 0; x < width; ++x)
+			{
+				const Color* window = padded + x;
+				float r = 0, g = 0, b = 0;
+				for (int k = 0; k <= 2 * radius_x; ++k)
+				{
+					r += window[k].r * kernel_x[k];
+					g += window[k].g * kernel_x[k];
+					b += window[k].b * kernel_x[k];
+				}
+				row[x * 3] = r;
+				row[x * 3 + 1] = g;
+				row[x * 3 + 2] = b;
+			}
+		}
+	});
+
+	//vertical, every result row is the weighted sum of whole rows
+	JobSystem::get().parallelFor(0, height, FILTER_GRAIN, [&](int from, int to) {
+		Arena& job_arena = Arena::getFrame();
+		ArenaScope job_scope(job_arena);
+		float* sums = job_arena.allocateArray<float>(channels);
+		Color* scratch = job_arena.allocateArray<Color>(width);
+		unsigned char* result = (unsigned char*)scratch;
+		for (int y = from; y < to; ++y)
+		{
+			for (unsigned int i = 0; i < channels; ++i)
+				sums[i] = bias + 0.5f;
+			for (int k = -radius_y; k <= radius_y; ++k)
+			{
+				const float* row = rows + (size_t)clampRow(y + k, height) * channels;
+				float weight = kernel_y[k + radius_y];
+				for (unsigned int i = 0; i < channels; ++i)
+					sums[i] += row[i] * weight;
+			}
+			for (unsigned int i = 0; i < channels; ++i)
+				result[i] = (unsigned char)(sums[i] < 0 ? 0 : (sums[i] > 255 ? 255 : sums[i]));
+			dst.writeRow(y, scratch);
+		}
+	});
+}
+
+void sharpen(Image& img, float sigma, float amount)
+{
+	Image blurred(img);
+	gaussianBlur(blurred, sigma);
+	forEachPixel(PARALLEL_CHUNKED, img, blurred, [amount](Color c, Color blur) {
+		Color result;
+		for (int i = 0; i < 3; ++i)
+		{
+			float v = c.v[i] + (c.v[i] - blur.v[i]) * amount + 0.5f;
+			result.v[i] = (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+		}
+		return result;
+	});
+}
@@ -0,0 +1,27 @@
+/*  Filters for the post-processing of the frames.
+	All of them are separable: a pass along the rows into a temporary buffer and another along its columns.
+	The borders repeat the pixels of the edges, every row is copied once with the repeated pixels around it and the
+	vertical pass clamps the rows it reads, so the taps never check the borders.
+	The box blur keeps a running sum of the window, so its cost doesn't depend on the radius, and three box blurs in a
+	row approximate a gaussian. The rows are split between the threads of the job system and the images can have any layout.
+*/
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "image.h"
+
+//average of the (2*radius+1)^2 pixels around every pixel
+void boxBlur(Image& img, int radius);
+
+//gaussian blur approximated with three box blurs, sigma in pixels
+void gaussianBlur(Image& img, float sigma);
+
+//convolves src with kernel_x along the rows and kernel_y along the columns and writes it in dst (it can be src)
+//the kernels have 2*radius+1 weights, bias is added to the result (128 shows the negative values of an edge detector)
+void convolveSeparable(const Image& src, Image& dst, const float* kernel_x, int radius_x, const float* kernel_y, int radius_y, float bias = 0);
+
+//adds amount times the difference with the blurred image (unsharp mask)
+void sharpen(Image& img, float sigma, float amount);
+
+#endif
@@ -4,6 +4,7 @@
 #include <cassert>
 #include <cmath> //for sqrt (square root) function
 #include <math.h> //atan2
+#include <cfloat>
 
 
 #define M_PI_2 1.57079632679489661923
@@ -58,22 +59,30 @@ Vector2 operator - (const Vector2& a, const Vector2& b) { return Vector2(a.x - b
 
 // **************************************
 
+//computed in float, the double is only the return type
 double Vector3::length() 
 {
-	return sqrt(x*x + y*y + z*z);
+	return sqrtf(x*x + y*y + z*z);
 }
 
 double Vector3::length() const
 {
-	return sqrt(x*x + y*y + z*z);
+	return sqrtf(x*x + y*y + z*z);
 }
 
 Vector3& Vector3::normalize()
 {
-	double len = length();
-	x /= len;
-	y /= len;
-	z /= len;
+	float len2 = x*x + y*y + z*z;
+	if (len2 <= 0.0f)
+		return *this;
+#ifdef FRAMEWORK_SSE
+	float inv_len = _mm_cvtss_f32(_mm_div_ss(_mm_set_ss(1.0f), _mm_sqrt_ss(_mm_set_ss(len2))));
+#else
+	float inv_len = 1.0f / sqrtf(len2);
+#endif
+	x *= inv_len;
+	y *= inv_len;
+	z *= inv_len;
 	return *this;
 }
 
@@ -110,6 +119,19 @@ void Vector3::random(Vector3 range)
 
 
 //*********************************
+#ifdef FRAMEWORK_SSE
+//the rows of the matrix (m[0..3], m[4..7], ...) are combined with the components of the vector:
+//  result = row0 * x + row1 * y + row2 * z + row3 * w
+//that is a vector transform and also one row of a matrix product
+static inline __m128 combineRows(const float* m, __m128 x, __m128 y, __m128 z, __m128 w)
+{
+	__m128 r = _mm_mul_ps(_mm_loadu_ps(m), x);
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 4), y));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 8), z));
+	return _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 12), w));
+}
+#endif
+
 Matrix44::Matrix44()
 {
 	setIdentity();
@@ -160,13 +182,21 @@ void Matrix44::rotate( float angle_in_rad, const Vector3& axis )
 	*this = *this * R;
 }
 
-Vector3 Matrix44::rotateVector(const Vector3& v)
+//same as transforming with the translation set to zero, without copying the matrix
+Vector3 Matrix44::rotateVector(const Vector3& v) const
 {
-	Matrix44 temp = *this;
-	temp.m[12] = 0.0;
-	temp.m[13] = 0.0;
-	temp.m[14] = 0.0;
-	return temp * v;
+#ifdef FRAMEWORK_SSE
+	__m128 r = _mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(v.x));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_set1_ps(v.y)));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 8), _mm_set1_ps(v.z)));
+	alignas(16) float out[4];
+	_mm_store_ps(out, r);
+	return Vector3(out[0], out[1], out[2]);
+#else
+	return Vector3(	m[0] * v.x + m[4] * v.y + m[8] * v.z,
+					m[1] * v.x + m[5] * v.y + m[9] * v.z,
+					m[2] * v.x + m[6] * v.y + m[10] * v.z );
+#endif
 }
 
 void Matrix44::traslateLocal(float x, float y, float z)
@@ -280,16 +310,18 @@ Matrix44 Matrix44::operator*(const Matrix44& matrix) const
 {
 	Matrix44 ret;
 
-	unsigned int i,j,k;
-	for (i=0;i<4;i++) 	
+#ifdef FRAMEWORK_SSE
+	//every row of the result is the rows of the other matrix weighted by one row of this one
+	for (unsigned int i = 0; i < 4; i++)
 	{
-		for (j=0;j<4;j++) 
-		{
-			ret.M[i][j]=0.0;
-			for (k=0;k<4;k++) 
-				ret.M[i][j] += M[i][k] * matrix.M[k][j];
-		}
+		const float* row = M[i];
+		_mm_storeu_ps(ret.M[i], combineRows(matrix.m, _mm_set1_ps(row[0]), _mm_set1_ps(row[1]), _mm_set1_ps(row[2]), _mm_set1_ps(row[3])));
 	}
+#else
+	for (unsigned int i = 0; i < 4; i++)
+		for (unsigned int j = 0; j < 4; j++)
+			ret.M[i][j] = M[i][0] * matrix.M[0][j] + M[i][1] * matrix.M[1][j] + M[i][2] * matrix.M[2][j] + M[i][3] * matrix.M[3][j];
+#endif
 
 	return ret;
 }
@@ -319,20 +351,32 @@ Vector3 operator / (const Vector3& a, float v)
 //Multiplies a vector by a matrix and returns the new vector
 Vector3 operator * (const Matrix44& matrix, const Vector3& v) 
 {   
+#ifdef FRAMEWORK_SSE
+   alignas(16) float out[4];
+   _mm_store_ps(out, combineRows(matrix.m, _mm_set1_ps(v.x), _mm_set1_ps(v.y), _mm_set1_ps(v.z), _mm_set1_ps(1.0f)));
+   return Vector3(out[0], out[1], out[2]);
+#else
    float x = matrix.m[0] * v.x + matrix.m[4] * v.y + matrix.m[8] * v.z + matrix.m[12]; 
    float y = matrix.m[1] * v.x + matrix.m[5] * v.y + matrix.m[9] * v.z + matrix.m[13]; 
    float z = matrix.m[2] * v.x + matrix.m[6] * v.y + matrix.m[10] * v.z + matrix.m[14];
    return Vector3(x,y,z);
+#endif
 }
 
 //Multiplies a vector by a matrix and returns the new vector
 Vector4 operator * (const Matrix44& matrix, const Vector4& v) 
 {   
+#ifdef FRAMEWORK_SSE
+   Vector4 result;
+   _mm_storeu_ps(result.v, combineRows(matrix.m, _mm_set1_ps(v.x), _mm_set1_ps(v.y), _mm_set1_ps(v.z), _mm_set1_ps(v.w)));
+   return result;
+#else
    float x = matrix.m[0] * v.x + matrix.m[4] * v.y + matrix.m[8] * v.z + matrix.m[12] * v.w; 
    float y = matrix.m[1] * v.x + matrix.m[5] * v.y + matrix.m[9] * v.z + matrix.m[13] * v.w; 
    float z = matrix.m[2] * v.x + matrix.m[6] * v.y + matrix.m[10] * v.z + matrix.m[14] * v.w;
    float w = matrix.m[3] * v.x + matrix.m[7] * v.y + matrix.m[11] * v.z + matrix.m[15] * v.w;
    return Vector4(x,y,z,w);
+#endif
 }
 
 void Matrix44::setUpAndOrthonormalize(Vector3 up)
@@ -408,6 +452,96 @@ void Matrix44::setFrontAndOrthonormalize(Vector3 front)
 	
 }
 
+#ifdef FRAMEWORK_SSE
+//inverse using cofactors (the adjugate divided by the determinant), four cofactors at a time
+//based on the Intel "Streaming SIMD Extensions - Inverse of 4x4 Matrix" application note
+bool Matrix44::inverse()
+{
+	__m128 minor0, minor1, minor2, minor3;
+	__m128 row0, row1, row2, row3;
+	__m128 det, tmp;
+	const float* src = m;
+
+	//load the matrix transposed
+	tmp = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(src)), (const __m64*)(src + 4));
+	row1 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(src + 8)), (const __m64*)(src + 12));
+	row0 = _mm_shuffle_ps(tmp, row1, 0x88);
+	row1 = _mm_shuffle_ps(row1, tmp, 0xDD);
+	tmp = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(src + 2)), (const __m64*)(src + 6));
+	row3 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(src + 10)), (const __m64*)(src + 14));
+	row2 = _mm_shuffle_ps(tmp, row3, 0x88);
+	row3 = _mm_shuffle_ps(row3, tmp, 0xDD);
+
+	tmp = _mm_mul_ps(row2, row3);
+	tmp = _mm_shuffle_ps(tmp, tmp, 0xB1);
+	minor0 = _mm_mul_ps(row1, tmp);
+	minor1 = _mm_mul_ps(row0, tmp);
+	tmp = _mm_shuffle_ps(tmp, tmp, 0x4E);
+	minor0 = _mm_sub_ps(_mm_mul_ps(row1, tmp), minor0);
+	minor1 = _mm_sub_ps(_mm_mul_ps(row0, tmp), minor1);
+	minor1 = _mm_shuffle_ps(minor1, minor1, 0x4E);
+
+	tmp = _mm_mul_ps(row1, row2);
+	tmp = _mm_shuffle_ps(tmp, tmp, 0xB1);
+	minor0 = _mm_add_ps(_mm_mul_ps(row3, tmp), minor0);
+	minor3 = _mm_mul_ps(row0, tmp);
+	tmp = _mm_shuffle_ps(tmp, tmp, 0x4E);
+	minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row3, tmp));
+	minor3 = _mm_sub_ps(_mm_mul_ps(row0, tmp), minor3);
+	minor3 = _mm_shuffle_ps(minor3, minor3, 0x4E);
+
+	tmp = _mm_mul_ps(_mm_shuffle_ps(row1, row1, 0x4E), row3);
+	tmp = _mm_shuffle_ps(tmp, tmp, 0xB1);
+	row2 = _mm_shuffle_ps(row2, row2, 0x4E);
+	minor0 = _mm_add_ps(_mm_mul_ps(row2, tmp), minor0);
+	minor2 = _mm_mul_ps(row0, tmp);
+	tmp = _mm_shuffle_ps(tmp, tmp, 0x4E);
+	minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row2, tmp));
+	minor2 = _mm_sub_ps(_mm_mul_ps(row0, tmp), minor2);
+	minor2 = _mm_shuffle_ps(minor2, minor2, 0x4E);
+
+	tmp = _mm_mul_ps(row0, row1);
+	tmp = _mm_shuffle_ps(tmp, tmp, 0xB1);
+	minor2 = _mm_add_ps(_mm_mul_ps(row3, tmp), minor2);
+	minor3 = _mm_sub_ps(_mm_mul_ps(row2, tmp), minor3);
+	tmp = _mm_shuffle_ps(tmp, tmp, 0x4E);
+	minor2 = _mm_sub_ps(_mm_mul_ps(row3, tmp), minor2);
+	minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row2, tmp));
+
+	tmp = _mm_mul_ps(row0, row3);
+	tmp = _mm_shuffle_ps(tmp, tmp, 0xB1);
+	minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row2, tmp));
+	minor2 = _mm_add_ps(_mm_mul_ps(row1, tmp), minor2);
+	tmp = _mm_shuffle_ps(tmp, tmp, 0x4E);
+	minor1 = _mm_add_ps(_mm_mul_ps(row2, tmp), minor1);
+	minor2 = _mm_sub_ps(minor2, _mm_mul_ps(row1, tmp));
+
+	tmp = _mm_mul_ps(row0, row2);
+	tmp = _mm_shuffle_ps(tmp, tmp, 0xB1);
+	minor1 = _mm_add_ps(_mm_mul_ps(row3, tmp), minor1);
+	minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row1, tmp));
+	tmp = _mm_shuffle_ps(tmp, tmp, 0x4E);
+	minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row3, tmp));
+	minor3 = _mm_add_ps(_mm_mul_ps(row1, tmp), minor3);
+
+	//determinant, in all the lanes
+	det = _mm_mul_ps(row0, minor0);
+	det = _mm_add_ps(_mm_shuffle_ps(det, det, 0x4E), det);
+	det = _mm_add_ps(_mm_shuffle_ps(det, det, 0xB1), det);
+
+	//singular matrix, leave it as it is
+	float d = _mm_cvtss_f32(det);
+	if (!(fabsf(d) > 0.0f) || !(fabsf(d) <= FLT_MAX))
+		return false;
+
+	det = _mm_div_ps(_mm_set1_ps(1.0f), det);
+	_mm_storeu_ps(m, _mm_mul_ps(det, minor0));
+	_mm_storeu_ps(m + 4, _mm_mul_ps(det, minor1));
+	_mm_storeu_ps(m + 8, _mm_mul_ps(det, minor2));
+	_mm_storeu_ps(m + 12, _mm_mul_ps(det, minor3));
+	return true;
+}
+#else
 bool Matrix44::inverse()
 {
    unsigned int i, j, k, swap;
@@ -480,6 +614,7 @@ bool Matrix44::inverse()
 
    return true;
 }
+#endif
 
 float ComputeSignedAngle( Vector2 a, Vector2 b)
 {
@@ -13,6 +13,13 @@
 #endif
 #define DEG2RAD 0.0174532925
 
+//SIMD backend for the math classes: SSE when the compiler targets it (always on x64), plain C++ otherwise
+//define FRAMEWORK_NO_SIMD to force the plain version
+#if !defined(FRAMEWORK_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+	#define FRAMEWORK_SSE
+	#include <xmmintrin.h>
+#endif
+
 //clamp a value 'x' between 'a' and 'b'
 inline float clamp(float x, float a, float b) { return x < a ? a : (x > b ? b : x); }
 inline unsigned int clamp(unsigned int x, unsigned int a, unsigned int b) { return x < a ? a : (x > b ? b : x); }
@@ -91,6 +98,7 @@ public:
 };
 
 
+//four floats, a whole vector fits in one SIMD register (loaded unaligned, the heap may not align it)
 class Vector4
 {
 public:
@@ -109,6 +117,7 @@ public:
 
 //****************************
 //Matrix44 class
+//every row can be loaded in a SIMD register, with unaligned loads (the heap may not align it to 16)
 class Matrix44
 {
 	public:
@@ -147,7 +156,7 @@ class Matrix44
 		Matrix44 getRotationOnly(); //used when having scale
 
 		//rotate only
-		Vector3 rotateVector( const Vector3& v);
+		Vector3 rotateVector( const Vector3& v) const;
 
 		//transform using world coordinates
 		void traslate(float x, float y, float z);
@@ -186,15 +195,15 @@ public:
 	Vector2() { x = y = 0.0f; }
 	Vector2(float x, float y) { this->x = x; this->y = y; }
 
-	double length() { return sqrt(x*x + y*y); }
-	double length() const { return sqrt(x*x + y*y); }
+	double length() { return sqrtf(x*x + y*y); }
+	double length() const { return sqrtf(x*x + y*y); }
 
 	float dot( const Vector2& v );
 	float perpdot( const Vector2& v );
 
 	void set(float x, float y) { this->x = x; this->y = y; }
 
-	Vector2& normalize() { *this *= 1.0f / (float)length(); return *this; }
+	Vector2& normalize() { float len = sqrtf(x*x + y*y); if (len > 0.0f) *this *= 1.0f / len; return *this; }
 
 	float distance(const Vector2& v);
 	void random(float range);
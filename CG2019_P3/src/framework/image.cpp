@@ -1,19 +1,54 @@
 #include "image.h"
+#include "rasterizer.h"
+#include "sampler.h"
+#include "jobs.h"
+#include "allocator.h"
+#include "resample.h"
+#include "lines.h"
+#include "polygon.h"
 
 
+//malloc with room to move the start to the next multiple of the alignment, the pointer to free is kept just before it
+void* alignedAlloc(size_t size)
+{
+	void* block = malloc(size + IMAGE_ALIGNMENT + sizeof(void*));
+	if (!block)
+		return NULL;
+	size_t start = ((size_t)block + sizeof(void*) + IMAGE_ALIGNMENT - 1) & ~(size_t)(IMAGE_ALIGNMENT - 1);
+	((void**)start)[-1] = block;
+	return (void*)start;
+}
+
+void alignedFree(void* data)
+{
+	if (data)
+		free(((void**)data)[-1]);
+}
+
+ImageView ImageView::getArea(unsigned int x, unsigned int y, unsigned int width, unsigned int height) const
+{
+	if (x >= this->width || y >= this->height)
+		return ImageView();
+	if (width > this->width - x) width = this->width - x;
+	if (height > this->height - y) height = this->height - y;
+	return ImageView(pixels + y * stride + x, width, height, stride);
+}
+
 Image::Image() {
 	width = 0; height = 0;
 	pixels = NULL;
-	raster = nullptr;
+	layout = LINEAR;
+	tiles_x = 0;
 }
 
-Image::Image(unsigned int width, unsigned int height)
+Image::Image(unsigned int width, unsigned int height, PixelLayout layout)
 {
 	this->width = width;
 	this->height = height;
-	pixels = new Color[width*height];
-	memset(pixels, 0, width * height * sizeof(Color));
-	raster = nullptr;
+	this->layout = layout;
+	tiles_x = (width + PIXEL_TILE_MASK) >> PIXEL_TILE_BITS;
+	pixels = allocatePixels<Color>(storageSize());
+	memset((void*)pixels, 0, storageSize() * sizeof(Color));
 }
 
 //copy constructor
@@ -22,47 +57,76 @@ Image::Image(const Image& c) {
 
 	width = c.width;
 	height = c.height;
+	layout = c.layout;
+	tiles_x = c.tiles_x;
 	if(c.pixels)
 	{
-		pixels = new Color[width*height];
-		memcpy(pixels, c.pixels, width*height*sizeof(Color));
+		pixels = allocatePixels<Color>(storageSize());
+		memcpy(pixels, c.pixels, storageSize()*sizeof(Color));
 	}
-	if (c.raster)
-	{
-		raster = new RasterInfo[width * height];
-		std::memcpy(raster, c.raster, sizeof(RasterInfo) * height);
-	}
-	else raster = nullptr;
+}
+
+//move constructor, no pixel is copied
+Image::Image(Image&& c)
+{
+	width = c.width;
+	height = c.height;
+	layout = c.layout;
+	tiles_x = c.tiles_x;
+	pixels = c.pixels;
+	c.width = c.height = c.tiles_x = 0;
+	c.pixels = NULL;
+}
+
+Image::Image(const ImageView& view)
+{
+	width = view.width;
+	height = view.height;
+	layout = LINEAR;
+	tiles_x = (width + PIXEL_TILE_MASK) >> PIXEL_TILE_BITS;
+	pixels = allocatePixels<Color>(storageSize());
+	for(unsigned int y = 0; y < height; ++y)
+		memcpy(pixels + y * width, view.getRow(y), width * sizeof(Color));
 }
 
 //assign operator
 Image& Image::operator = (const Image& c)
 {
-	if(pixels) delete pixels;
+	if (this == &c)
+		return *this;
+	freePixels(pixels);
 	pixels = NULL;
 
 	width = c.width;
 	height = c.height;
+	layout = c.layout;
+	tiles_x = c.tiles_x;
 	if(c.pixels)
 	{
-		pixels = new Color[width*height*sizeof(Color)];
-		memcpy(pixels, c.pixels, width*height*sizeof(Color));
-	}
-	if (c.raster)
-	{
-		raster = new RasterInfo[width * height];
-		std::memcpy(raster, c.raster, sizeof(RasterInfo) * height);
+		pixels = allocatePixels<Color>(storageSize());
+		memcpy(pixels, c.pixels, storageSize()*sizeof(Color));
 	}
-	else raster = nullptr;
+	return *this;
+}
+
+Image& Image::operator = (Image&& c)
+{
+	if (this == &c)
+		return *this;
+	freePixels(pixels);
+	width = c.width;
+	height = c.height;
+	layout = c.layout;
+	tiles_x = c.tiles_x;
+	pixels = c.pixels;
+	c.width = c.height = c.tiles_x = 0;
+	c.pixels = NULL;
 	return *this;
 }
 
 Image::~Image()
 {
-	if(pixels) 
-		delete pixels;
-	if (raster)
-		delete raster;
+	freePixels(pixels);
 }
 
 
@@ -70,53 +134,173 @@ Image::~Image()
 //change image size (the old one will remain in the top-left corner)
 void Image::resize(unsigned int width, unsigned int height)
 {
-	Color* new_pixels = new Color[width*height];
+	unsigned int new_tiles_x = (width + PIXEL_TILE_MASK) >> PIXEL_TILE_BITS;
+	Color* new_pixels = allocatePixels<Color>(pixelStorageSize(layout, width, height));
+	memset((void*)new_pixels, 0, pixelStorageSize(layout, width, height) * sizeof(Color));
 	unsigned int min_width = this->width > width ? width : this->width;
 	unsigned int min_height = this->height > height ? height : this->height;
 
-	for(unsigned int x = 0; x < min_width; ++x)
-		for(unsigned int y = 0; y < min_height; ++y)
-			new_pixels[ y * width + x ] = getPixel(x,y);
+	for(unsigned int y = 0; y < min_height; ++y)
+		for(unsigned int x = 0; x < min_width; ++x)
+			new_pixels[ pixelIndex(layout, width, new_tiles_x, x, y) ] = getPixel(x,y);
 
-	delete pixels;
+	freePixels(pixels);
 	this->width = width;
 	this->height = height;
+	tiles_x = new_tiles_x;
 	pixels = new_pixels;
+}
+
+//change image size and scale the content with the filter
+void Image::scale(unsigned int width, unsigned int height, ResampleFilter filter)
+{
+	Image result(width, height, layout);
+	resample(*this, result, filter);
+
+	freePixels(pixels);
+	this->width = width;
+	this->height = height;
+	tiles_x = result.tiles_x;
+	pixels = result.pixels;
+	result.pixels = NULL;
+}
+
+void Image::setLayout(PixelLayout layout)
+{
+	if (this->layout == layout)
+		return;
 
-	if (raster)
+	Color* new_pixels = allocatePixels<Color>(pixelStorageSize(layout, width, height));
+	if (pixels)
 	{
-		delete raster;
-		raster = nullptr;
+		for (unsigned int y = 0; y < height; ++y)
+			for (unsigned int x = 0; x < width; ++x)
+				new_pixels[pixelIndex(layout, width, tiles_x, x, y)] = getPixel(x, y);
+		freePixels(pixels);
 	}
+	pixels = new_pixels;
+	this->layout = layout;
 }
 
-//change image size and scale the content
-void Image::scale(unsigned int width, unsigned int height)
+void Image::copyToLinear(Color* dest) const
 {
-	Color* new_pixels = new Color[width*height];
+	if (layout == LINEAR)
+	{
+		memcpy(dest, pixels, width * height * sizeof(Color));
+		return;
+	}
 
-	for(unsigned int x = 0; x < width; ++x)
-		for(unsigned int y = 0; y < height; ++y)
-			new_pixels[ y * width + x ] = getPixel((unsigned int)(this->width * (x / (float)width)), (unsigned int)(this->height * (y / (float)height)) );
+	//every row of a tile is a contiguous run of PIXEL_TILE_SIZE pixels
+	for (unsigned int y = 0; y < height; ++y)
+		for (unsigned int x = 0; x < width; x += PIXEL_TILE_SIZE)
+		{
+			unsigned int count = width - x < PIXEL_TILE_SIZE ? width - x : PIXEL_TILE_SIZE;
+			memcpy(dest + y * width + x, pixels + index(x, y), count * sizeof(Color));
+		}
+}
 
-	delete pixels;
-	this->width = width;
-	this->height = height;
-	pixels = new_pixels;
+const Color* Image::readRow(unsigned int y, Color* scratch) const
+{
+	if (layout == LINEAR)
+		return pixels + y * width;
+
+	//the row is split in runs of PIXEL_TILE_SIZE pixels, one per tile
+	for (unsigned int x = 0; x < width; x += PIXEL_TILE_SIZE)
+	{
+		unsigned int count = width - x < PIXEL_TILE_SIZE ? width - x : PIXEL_TILE_SIZE;
+		memcpy(scratch + x, pixels + index(x, y), count * sizeof(Color));
+	}
+	return scratch;
+}
+
+void Image::writeRow(unsigned int y, const Color* row)
+{
+	if (layout == LINEAR)
+	{
+		if (row != pixels + y * width)
+			memcpy(pixels + y * width, row, width * sizeof(Color));
+		return;
+	}
+
+	for (unsigned int x = 0; x < width; x += PIXEL_TILE_SIZE)
+	{
+		unsigned int count = width - x < PIXEL_TILE_SIZE ? width - x : PIXEL_TILE_SIZE;
+		memcpy(pixels + index(x, y), row + x, count * sizeof(Color));
+	}
+}
+
+//16 pixels are 48 bytes, three 16 byte stores
+#define FILL_BLOCK 16
+
+//memset when the three channels are equal, if not copies of a block of pixels
+static void fillPixels(Color* pixels, unsigned int count, const Color& c)
+{
+	if (c.r == c.g && c.g == c.b)
+	{
+		memset((void*)pixels, c.r, count * sizeof(Color));
+		return;
+	}
+
+	Color block[FILL_BLOCK];
+	for (unsigned int i = 0; i < FILL_BLOCK; ++i)
+		block[i] = c;
+	for (; count >= FILL_BLOCK; count -= FILL_BLOCK, pixels += FILL_BLOCK)
+		memcpy(pixels, block, sizeof(block));
+	for (unsigned int i = 0; i < count; ++i)
+		pixels[i] = c;
+}
+
+void Image::fillSpan(unsigned int y, unsigned int x0, unsigned int x1, const Color& c)
+{
+	if (layout == LINEAR)
+	{
+		fillPixels(pixels + y * width + x0, x1 - x0 + 1, c);
+		return;
+	}
+
+	//one run per tile
+	for (unsigned int x = x0; x <= x1; )
+	{
+		unsigned int end = (x | PIXEL_TILE_MASK) < x1 ? (x | PIXEL_TILE_MASK) : x1;
+		fillPixels(pixels + index(x, y), end - x + 1, c);
+		x = end + 1;
+	}
+}
+
+ImageView Image::getView(unsigned int x, unsigned int y, unsigned int width, unsigned int height) const
+{
+	if (layout != LINEAR)
+		return ImageView();
+	return ImageView(pixels, this->width, this->height, this->width).getArea(x, y, width, height);
 }
 
 Image Image::getArea(unsigned int start_x, unsigned int start_y, unsigned int width, unsigned int height)
 {
 	Image result(width, height);
-	for(unsigned int x = 0; x < width; ++x)
-		for(unsigned int y = 0; y < height; ++x)
-		{
-			if( (x + start_x) < this->width && (y + start_y) < this->height) 
-				result.setPixel( x, y, getPixel(x + start_x,y + start_y) );
-		}
+	getArea(start_x, start_y, width, height, result);
 	return result;
 }
 
+//the pixels outside of this image are left as they were in result
+void Image::getArea(unsigned int start_x, unsigned int start_y, unsigned int width, unsigned int height, Image& result) const
+{
+	if (result.width != width || result.height != height)
+		result.resize(width, height);
+
+	//between linear images whole rows are copied
+	ImageView area = getView(start_x, start_y, width, height);
+	if (result.layout == LINEAR && !area.isEmpty())
+	{
+		for(unsigned int y = 0; y < area.height; ++y)
+			memcpy(result.pixels + y * width, area.getRow(y), area.width * sizeof(Color));
+		return;
+	}
+
+	for(unsigned int y = 0; y < height && y + start_y < this->height; ++y)
+		for(unsigned int x = 0; x < width && x + start_x < this->width; ++x)
+			result.setPixel( x, y, getPixel(x + start_x,y + start_y) );
+}
+
 void Image::flipX()
 {
 	for(unsigned int x = 0; x < width * 0.5; ++x)
@@ -186,7 +370,7 @@ bool Image::loadTGA(const char* filename)
 	if (tgainfo->data == NULL || fread(tgainfo->data, 1, imageSize, file) != imageSize)
 	{
 		if (tgainfo->data != NULL)
-			delete tgainfo->data;
+			delete[] tgainfo->data;
             
 		fclose(file);
 		delete tgainfo;
@@ -196,12 +380,12 @@ bool Image::loadTGA(const char* filename)
 	fclose(file);
 
 	//save info in image
-	if(pixels)
-		delete pixels;
+	freePixels(pixels);
 
 	width = tgainfo->width;
 	height = tgainfo->height;
-	pixels = new Color[width*height];
+	tiles_x = (width + PIXEL_TILE_MASK) >> PIXEL_TILE_BITS;
+	pixels = allocatePixels<Color>(storageSize());
 
 	//convert to float all pixels
 	for(unsigned int y = 0; y < height; ++y)
@@ -211,7 +395,7 @@ bool Image::loadTGA(const char* filename)
 			this->setPixel(x , height - y - 1, Color( tgainfo->data[pos+2], tgainfo->data[pos+1], tgainfo->data[pos]) );
 		}
 
-	delete tgainfo->data;
+	delete[] tgainfo->data;
 	delete tgainfo;
 
 	return true;
@@ -243,16 +427,20 @@ bool Image::saveTGA(const char* filename)
 	fwrite(header, 1, 6, file);
 
 	//convert pixels to unsigned char
-	unsigned char* bytes = new unsigned char[width*height*3];
-	for(unsigned int y = 0; y < height; ++y)
-		for(unsigned int x = 0; x < width; ++x)
-		{
-			Color c = pixels[(height-y-1)*width+x];
-			unsigned int pos = (y*width+x)*3;
-			bytes[pos+2] = c.r;
-			bytes[pos+1] = c.g;
-			bytes[pos] = c.b;
-		}
+	//the rows are converted in parallel
+	ArenaScope scope(Arena::getFrame());
+	unsigned char* bytes = Arena::getFrame().allocateArray<unsigned char>(width*height*3);
+	JobSystem::get().parallelFor(0, height, 64, [&](int from, int to) {
+		for(unsigned int y = from; y < (unsigned int)to; ++y)
+			for(unsigned int x = 0; x < width; ++x)
+			{
+				Color c = getPixel(x, height-y-1);
+				unsigned int pos = (y*width+x)*3;
+				bytes[pos+2] = c.r;
+				bytes[pos+1] = c.g;
+				bytes[pos] = c.b;
+			}
+	});
 
 	fwrite(bytes, 1, width*height*3, file);
 	fclose(file);
@@ -260,19 +448,19 @@ bool Image::saveTGA(const char* filename)
 }
 
 /* My stuff */
-void Image::_clearRaster()
+//the limits of every row start empty
+Image::RasterInfo* Image::_clearRaster()
 {
-	if (!raster)
-		raster = new RasterInfo[height];
+	RasterInfo* raster = Arena::getFrame().allocateArray<RasterInfo>(height);
 	for (int i = 0; i < height; ++i)
 	{
 		raster[i].min = static_cast<unsigned int>(-1);
 		raster[i].max = static_cast<unsigned int>(0);
 	}
-	//std::memset(raster, 0, sizeof(RasterInfo) * height);
+	return raster;
 }
 
-void Image::_rasterTriangleLine(int x0, int y0, int x1, int y1)
+void Image::_rasterTriangleLine(RasterInfo* raster, int x0, int y0, int x1, int y1)
 {
 	int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
 	int dy = abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
@@ -295,43 +483,60 @@ void Image::_rasterTriangleLine(int x0, int y0, int x1, int y1)
 	}
 }
 
+//clipped once, see lines.h
 void Image::drawLine(int x0, int y0, int x1, int y1, const Color& color)
 {
-	int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
-	int dy = abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
-	int err = (dx > dy ? dx : -dy) / 2, e2;
+	::drawLine(*this, x0, y0, x1, y1, color);
+}
 
-	for (;;) {
+void ImageView::fill(const Color& c) const
+{
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		Color* row = getRow(y);
+		for (unsigned int x = 0; x < width; ++x)
+			row[x] = c;
+	}
+}
 
-		if(y0 >= 0 && y0 < height && x0 > 0 && x0 < width)
-			pixels[y0 * width + x0] = color;
+void ImageView::drawImage(const ImageView& img, unsigned int x, unsigned int y) const
+{
+	ImageView area = getArea(x, y, img.width, img.height);
+	for (unsigned int j = 0; j < area.height; ++j)
+		memcpy(area.getRow(j), img.getRow(j), area.width * sizeof(Color));
+}
 
-		if (x0 == x1 && y0 == y1) break;
-		e2 = err;
-		if (e2 > -dx) { err -= dy; x0 += sx; }
-		if (e2 < dy) { err += dx; y0 += sy; }
-	}
+//clipped once, see lines.h
+void ImageView::drawLine(int x0, int y0, int x1, int y1, const Color& color) const { ::drawLine(*this, x0, y0, x1, y1, color); }
+
+//the same rasterizer as the 3D triangles, without depth
+void ImageView::fillTriangle(const Vector3& v0, const Vector3& v1, const Vector3& v2, const Color& color) const
+{
+	RasterTriangle tri;
+	if (!tri.setup(v0, v1, v2, width, height))
+		return;
+
+	tri.traverse([&](int x, int y, float, float, float) {
+		setPixel(x, y, color);
+	});
 }
 
-void Image::fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, const Color& color)
+void ImageView::fillInterpolatedTriangle(const Vector3& v0, const Vector3& v1, const Vector3& v2, const Color& c0, const Color& c1, const Color& c2) const
 {
-	// raster part //
-	_clearRaster();
+	RasterTriangle tri;
+	if (!tri.setup(v0, v1, v2, width, height))
+		return;
 
-	_rasterTriangleLine(x0, y0, x1, y1);
-	_rasterTriangleLine(x0, y0, x2, y2);
-	_rasterTriangleLine(x1, y1, x2, y2);
+	tri.traverse([&](int x, int y, float w0, float w1, float w2) {
+		setPixel(x, y, c0 * w0 + c1 * w1 + c2 * w2);
+	});
+}
 
-	// fill part //
-	for (unsigned int y = 0; y < height; ++y)
-	{
-		if (raster[y].min < raster[y].max)
-		{
-			unsigned int max = raster[y].max;
-			for (unsigned int x = raster[y].min; x < max; ++x)
-				pixels[y * width + x] = color;
-		}
-	}
+void Image::fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, const Color& color)
+{
+	//a polygon of three points, see polygon.h
+	Vector2 points[3] = { Vector2((float)x0, (float)y0), Vector2((float)x1, (float)y1), Vector2((float)x2, (float)y2) };
+	fillPolygon(*this, points, 3, color);
 }
 
 /*Vector3 Image::_weights(int x, int y, const Vector2& p0, const Vector2& p1, const Vector2& p2)
@@ -380,11 +585,12 @@ Color Image::_interpolatedColor(
 void Image::fillInterpolatedTriangle(int x0, int y0, int x1, int y1, int x2, int y2, const Color& c0, const Color& c1, const Color& c2)
 {
 	// raster part //
-	_clearRaster();
+	ArenaScope scope(Arena::getFrame()); //the limits of the rows are freed when the triangle is done
+	RasterInfo* raster = _clearRaster();
 
-	_rasterTriangleLine(x0, y0, x1, y1);
-	_rasterTriangleLine(x0, y0, x2, y2);
-	_rasterTriangleLine(x1, y1, x2, y2);
+	_rasterTriangleLine(raster, x0, y0, x1, y1);
+	_rasterTriangleLine(raster, x0, y0, x2, y2);
+	_rasterTriangleLine(raster, x1, y1, x2, y2);
 
 	// interpoalted fill part //
 	const Vector2 p0{ static_cast<float>(x0), static_cast<float>(y0) };
@@ -397,7 +603,7 @@ void Image::fillInterpolatedTriangle(int x0, int y0, int x1, int y1, int x2, int
 		{
 			unsigned int max = raster[y].max;
 			for (unsigned int x = raster[y].min; x < max; ++x)
-				pixels[y * width + x] = _interpolatedColor(x, y, p0, p1, p2, c0, c1, c2);
+				setPixel(x, y, _interpolatedColor(x, y, p0, p1, p2, c0, c1, c2));
 		}
 	}
 }
@@ -406,70 +612,36 @@ void Image::fillInterpolatedTriangle(int x0, int y0, int x1, int y1, int x2, int
 
 void Image::fillTriangle(FloatImage* z_buffer, const Vector3& v0, const Vector3& v1, const Vector3& v2, const Color& color)
 {
-	// raster part //
-	_clearRaster();
-
-	_rasterTriangleLine(static_cast<int>(v0.x), static_cast<int>(v0.y), static_cast<int>(v1.x), static_cast<int>(v1.y));
-	_rasterTriangleLine(static_cast<int>(v0.x), static_cast<int>(v0.y), static_cast<int>(v2.x), static_cast<int>(v2.y));
-	_rasterTriangleLine(static_cast<int>(v1.x), static_cast<int>(v1.y), static_cast<int>(v2.x), static_cast<int>(v2.y));
-
-	// fill part //
-	const Vector2 p0{ v0.x, v0.y };
-	const Vector2 p1{ v1.x, v1.y };
-	const Vector2 p2{ v2.x, v2.y };
-
-	for (unsigned int y = 0; y < height; ++y)
-	{
-		if (raster[y].min < raster[y].max)
+	RasterTriangle tri;
+	if (!tri.setup(v0, v1, v2, width, height))
+		return;
+
+	tri.traverse([&](int x, int y, float w0, float w1, float w2) {
+		float depth = v0.z * w0 + v1.z * w1 + v2.z * w2;
+		float& z_buffer_depth = z_buffer->getPixelRef(x, y);
+		if (depth < z_buffer_depth)
 		{
-			unsigned int max = raster[y].max;
-			for (unsigned int x = raster[y].min; x < max; ++x)
-			{
-				Vector3 w = _weights(x, y, p0, p1, p2);
-				float depth = v0.z * w.x + v1.z * w.y + v2.z * w.z;
-				float& z_buffer_depth = z_buffer->getPixelRef(x, y);
-				if (depth < z_buffer_depth)
-				{
-					z_buffer_depth = depth;
-					pixels[y * width + x] = color;
-				}
-			}
+			z_buffer_depth = depth;
+			setPixel(x, y, color);
 		}
-	}
+	});
 }
 
 void Image::fillInterpolatedTriangle(FloatImage* z_buffer, const Vector3& v0, const Vector3& v1, const Vector3& v2, const Color& c0, const Color& c1, const Color& c2)
 {
-	// raster part //
-	_clearRaster();
-
-	_rasterTriangleLine(static_cast<int>(v0.x), static_cast<int>(v0.y), static_cast<int>(v1.x), static_cast<int>(v1.y));
-	_rasterTriangleLine(static_cast<int>(v0.x), static_cast<int>(v0.y), static_cast<int>(v2.x), static_cast<int>(v2.y));
-	_rasterTriangleLine(static_cast<int>(v1.x), static_cast<int>(v1.y), static_cast<int>(v2.x), static_cast<int>(v2.y));
-
-	// fill part //
-	const Vector2 p0{ v0.x, v0.y };
-	const Vector2 p1{ v1.x, v1.y };
-	const Vector2 p2{ v2.x, v2.y };
-
-	for (unsigned int y = 0; y < height; ++y)
-	{
-		if (raster[y].min < raster[y].max)
+	RasterTriangle tri;
+	if (!tri.setup(v0, v1, v2, width, height))
+		return;
+
+	tri.traverse([&](int x, int y, float w0, float w1, float w2) {
+		float depth = v0.z * w0 + v1.z * w1 + v2.z * w2;
+		float& z_buffer_depth = z_buffer->getPixelRef(x, y);
+		if (depth < z_buffer_depth)
 		{
-			unsigned int max = raster[y].max;
-			for (unsigned int x = raster[y].min; x < max; ++x)
-			{
-				Vector3 w = _weights(x, y, p0, p1, p2);
-				float depth = v0.z * w.x + v1.z * w.y + v2.z * w.z;
-				float& z_buffer_depth = z_buffer->getPixelRef(x, y);
-				if (depth < z_buffer_depth)
-				{
-					z_buffer_depth = depth;
-					pixels[y * width + x] = c0 * w.x + c1 * w.y + c2 * w.z;
-				}
-			}
+			z_buffer_depth = depth;
+			setPixel(x, y, c0 * w0 + c1 * w1 + c2 * w2);
 		}
-	}
+	});
 }
 
 
@@ -483,48 +655,62 @@ void Image::fillTexturedTriangle(
 	Vector2 t0, Vector2 t1, Vector2 t2
 )
 {
-	// raster part //
-	_clearRaster();
-
-	_rasterTriangleLine(static_cast<int>(v0.x), static_cast<int>(v0.y), static_cast<int>(v1.x), static_cast<int>(v1.y));
-	_rasterTriangleLine(static_cast<int>(v0.x), static_cast<int>(v0.y), static_cast<int>(v2.x), static_cast<int>(v2.y));
-	_rasterTriangleLine(static_cast<int>(v1.x), static_cast<int>(v1.y), static_cast<int>(v2.x), static_cast<int>(v2.y));
-
-	// fill part //
-	const Vector2 p0{ v0.x, v0.y };
-	const Vector2 p1{ v1.x, v1.y };
-	const Vector2 p2{ v2.x, v2.y };
+	RasterTriangle tri;
+	if (!tri.setup(v0, v1, v2, width, height))
+		return;
 
 	vector2ClipToScreen(t0, texture->width, texture->height);
 	vector2ClipToScreen(t1, texture->width, texture->height);
 	vector2ClipToScreen(t2, texture->width, texture->height);
 
-	for (unsigned int y = 0; y < height; ++y)
-	{
-		if (raster[y].min < raster[y].max)
+	tri.traverse([&](int x, int y, float w0, float w1, float w2) {
+		float depth = v0.z * w0 + v1.z * w1 + v2.z * w2;
+		float& z_buffer_depth = z_buffer->getPixelRef(x, y);
+		if (depth < z_buffer_depth)
 		{
-			unsigned int max = raster[y].max;
-			for (unsigned int x = raster[y].min; x < max; ++x)
-			{
-				Vector3 w = _weights(x, y, p0, p1, p2);
-				if(std::abs(w.x) > 1 || std::abs(w.y) > 1 || std::abs(w.z) > 1)
-					w = _weights(x, y, p0, p1, p2);
-				if (w.x >= 0 && w.y >= 0 && w.z >= 0)
-				{
-					float depth = v0.z * w.x + v1.z * w.y + v2.z * w.z;
-					float& z_buffer_depth = z_buffer->getPixelRef(x, y);
-					if (depth < z_buffer_depth)
-					{
-						z_buffer_depth = depth;
-						pixels[y * width + x] = texture->getPixel(
-							static_cast<unsigned int>(t0.x * w.x + t1.x * w.y + t2.x * w.z),
-							static_cast<unsigned int>(t0.y * w.x + t1.y * w.y + t2.y * w.z)
-						);
-					}
-				}
-			}
+			z_buffer_depth = depth;
+			setPixel(x, y, texture->getPixelSafe(
+				static_cast<unsigned int>(t0.x * w0 + t1.x * w1 + t2.x * w2),
+				static_cast<unsigned int>(t0.y * w0 + t1.y * w1 + t2.y * w2)
+			));
 		}
-	}
+	});
+}
+
+//same as above but filtered with the sampler, the level of detail is constant for the whole triangle
+//because the texture coordinates are interpolated linearly in screen space
+void Image::fillTexturedTriangle(
+	FloatImage* z_buffer,
+	const Sampler* sampler,
+	const Vector3& v0, const Vector3& v1, const Vector3& v2,
+	Vector2 t0, Vector2 t1, Vector2 t2
+)
+{
+	RasterTriangle tri;
+	if (!tri.setup(v0, v1, v2, width, height))
+		return;
+
+	//from clip space (-1..1) to texture space (0..1)
+	vector2ClipToScreen(t0, 1.f, 1.f);
+	vector2ClipToScreen(t1, 1.f, 1.f);
+	vector2ClipToScreen(t2, 1.f, 1.f);
+
+	Vector3 dw_dx, dw_dy;
+	tri.getWeightSteps(dw_dx, dw_dy);
+	float lod = sampler->computeLod(
+		t0.x * dw_dx.x + t1.x * dw_dx.y + t2.x * dw_dx.z, t0.y * dw_dx.x + t1.y * dw_dx.y + t2.y * dw_dx.z,
+		t0.x * dw_dy.x + t1.x * dw_dy.y + t2.x * dw_dy.z, t0.y * dw_dy.x + t1.y * dw_dy.y + t2.y * dw_dy.z
+	);
+
+	tri.traverse([&](int x, int y, float w0, float w1, float w2) {
+		float depth = v0.z * w0 + v1.z * w1 + v2.z * w2;
+		float& z_buffer_depth = z_buffer->getPixelRef(x, y);
+		if (depth < z_buffer_depth)
+		{
+			z_buffer_depth = depth;
+			setPixel(x, y, sampler->sample(t0.x * w0 + t1.x * w1 + t2.x * w2, t0.y * w0 + t1.y * w1 + t2.y * w2, lod));
+		}
+	});
 }
 
 
@@ -532,12 +718,15 @@ void Image::fillTexturedTriangle(
 
 
 
-FloatImage::FloatImage(unsigned int width, unsigned int height)
+FloatImage::FloatImage(unsigned int width, unsigned int height, PixelLayout layout, unsigned int samples)
 {
 	this->width = width;
 	this->height = height;
-	pixels = new float[width*height];
-	memset(pixels, 0, width * height * sizeof(float));
+	this->layout = layout;
+	this->samples = samples;
+	tiles_x = (width + PIXEL_TILE_MASK) >> PIXEL_TILE_BITS;
+	pixels = allocatePixels<float>(storageSize());
+	memset(pixels, 0, storageSize() * sizeof(float));
 }
 
 //copy constructor
@@ -546,62 +735,103 @@ FloatImage::FloatImage(const FloatImage& c) {
 
 	width = c.width;
 	height = c.height;
+	layout = c.layout;
+	tiles_x = c.tiles_x;
+	samples = c.samples;
 	if (c.pixels)
 	{
-		pixels = new float[width*height];
-		memcpy(pixels, c.pixels, width*height * sizeof(float));
+		pixels = allocatePixels<float>(storageSize());
+		memcpy(pixels, c.pixels, storageSize() * sizeof(float));
 	}
 }
 
+FloatImage::FloatImage(FloatImage&& c)
+{
+	width = c.width;
+	height = c.height;
+	layout = c.layout;
+	tiles_x = c.tiles_x;
+	samples = c.samples;
+	pixels = c.pixels;
+	c.width = c.height = c.tiles_x = 0;
+	c.pixels = NULL;
+}
+
 //assign operator
 FloatImage& FloatImage::operator = (const FloatImage& c)
 {
-	if (pixels) delete pixels;
+	if (this == &c)
+		return *this;
+	freePixels(pixels);
 	pixels = NULL;
 
 	width = c.width;
 	height = c.height;
+	layout = c.layout;
+	tiles_x = c.tiles_x;
+	samples = c.samples;
 	if (c.pixels)
 	{
-		pixels = new float[width*height * sizeof(float)];
-		memcpy(pixels, c.pixels, width*height * sizeof(float));
+		pixels = allocatePixels<float>(storageSize());
+		memcpy(pixels, c.pixels, storageSize() * sizeof(float));
 	}
 	return *this;
 }
 
+FloatImage& FloatImage::operator = (FloatImage&& c)
+{
+	if (this == &c)
+		return *this;
+	freePixels(pixels);
+	width = c.width;
+	height = c.height;
+	layout = c.layout;
+	tiles_x = c.tiles_x;
+	samples = c.samples;
+	pixels = c.pixels;
+	c.width = c.height = c.tiles_x = 0;
+	c.pixels = NULL;
+	return *this;
+}
+
 FloatImage::~FloatImage()
 {
-	if (pixels)
-		delete pixels;
+	freePixels(pixels);
 }
 
 
 //change image size (the old one will remain in the top-left corner)
 void FloatImage::resize(unsigned int width, unsigned int height)
 {
-	float* new_pixels = new float[width*height];
+	unsigned int new_tiles_x = (width + PIXEL_TILE_MASK) >> PIXEL_TILE_BITS;
+	float* new_pixels = allocatePixels<float>(pixelStorageSize(layout, width, height) * samples);
 	unsigned int min_width = this->width > width ? width : this->width;
 	unsigned int min_height = this->height > height ? height : this->height;
 
-	for (unsigned int x = 0; x < min_width; ++x)
-		for (unsigned int y = 0; y < min_height; ++y)
-			new_pixels[y * width + x] = getPixel(x, y);
+	for (unsigned int y = 0; y < min_height; ++y)
+		for (unsigned int x = 0; x < min_width; ++x)
+			memcpy(new_pixels + pixelIndex(layout, width, new_tiles_x, x, y) * samples, pixels + index(x, y), samples * sizeof(float));
 
-	delete pixels;
+	freePixels(pixels);
 	this->width = width;
 	this->height = height;
+	tiles_x = new_tiles_x;
 	pixels = new_pixels;
 }
 
+void FloatImage::setLayout(PixelLayout layout)
+{
+	if (this->layout == layout)
+		return;
 
-#ifndef IGNORE_LAMBDAS
-
-//you can apply and algorithm for two images and store the result in the first one
-//forEachPixel( img, img2, [](Color a, Color b) { return a + b; } );
-template <typename F>
-void forEachPixel(Image& img, const Image& img2, F f) {
-	for(unsigned int pos = 0; pos < img.width * img.height; ++pos)
-		img.pixels[pos] = f( img.pixels[pos], img2.pixels[pos] );
+	float* new_pixels = allocatePixels<float>(pixelStorageSize(layout, width, height) * samples);
+	if (pixels)
+	{
+		for (unsigned int y = 0; y < height; ++y)
+			for (unsigned int x = 0; x < width; ++x)
+				memcpy(new_pixels + pixelIndex(layout, width, tiles_x, x, y) * samples, pixels + index(x, y), samples * sizeof(float));
+		freePixels(pixels);
+	}
+	pixels = new_pixels;
+	this->layout = layout;
 }
-
-#endif
\ No newline at end of file
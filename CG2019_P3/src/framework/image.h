@@ -11,12 +11,154 @@
 #include <stdio.h>
 #include <iostream>
 #include "framework.h"
+#include "jobs.h"
 
 //remove unsafe warnings
 #define _CRT_SECURE_NO_WARNINGS
 #pragma warning(disable:4996)
 
 class FloatImage;
+class Sampler;
+
+//how the pixels of an image are stored in memory
+enum PixelLayout
+{
+	LINEAR,	//row after row, as the screen and the TGA files expect them
+	TILED	//blocks of 8x8 pixels one after the other, so a small area of the image is in a few cache lines
+};
+
+//the filters to change the size of an image, see resample.h
+enum ResampleFilter
+{
+	RESAMPLE_NEAREST,
+	RESAMPLE_BILINEAR,
+	RESAMPLE_BICUBIC,	//Catmull-Rom, sharper than bilinear
+	RESAMPLE_LANCZOS	//3 lobes, the sharpest and the slowest
+};
+
+#define PIXEL_TILE_BITS 3
+#define PIXEL_TILE_SIZE (1 << PIXEL_TILE_BITS)
+#define PIXEL_TILE_MASK (PIXEL_TILE_SIZE - 1)
+
+//position in memory of the pixel x,y for the given layout
+inline unsigned int pixelIndex(PixelLayout layout, unsigned int width, unsigned int tiles_x, unsigned int x, unsigned int y)
+{
+	if (layout == LINEAR)
+		return y * width + x;
+	return ((((y >> PIXEL_TILE_BITS) * tiles_x + (x >> PIXEL_TILE_BITS)) << (2 * PIXEL_TILE_BITS)) + ((y & PIXEL_TILE_MASK) << PIXEL_TILE_BITS) + (x & PIXEL_TILE_MASK));
+}
+
+//number of elements to allocate for an image of that size
+inline unsigned int pixelStorageSize(PixelLayout layout, unsigned int width, unsigned int height)
+{
+	if (layout == LINEAR)
+		return width * height;
+	return ((width + PIXEL_TILE_MASK) & ~PIXEL_TILE_MASK) * ((height + PIXEL_TILE_MASK) & ~PIXEL_TILE_MASK);
+}
+
+//how the loops over the pixels are run, with the parallel ones the callbacks are called from several threads at once
+enum ExecutionPolicy
+{
+	SEQUENTIAL,			//in the calling thread
+	PARALLEL,			//the pixels are split between the threads of the job system
+	PARALLEL_CHUNKED	//same, in blocks of PIXEL_CHUNK_SIZE that are loops of fixed length the compiler can vectorize
+};
+
+//64 colors are 3 cache lines, so two threads never write in the same line
+#define PIXEL_CHUNK_SIZE 64
+//less pixels than this are not worth sending to other threads
+#define PIXEL_PARALLEL_MIN 16384
+
+//calls f(from, to) with pieces of [0, count) as the policy says, with PARALLEL_CHUNKED they start at multiples of the chunk
+template <typename F>
+void forEachRange(ExecutionPolicy policy, unsigned int count, F f)
+{
+	if (policy == SEQUENTIAL)
+		f(0u, count);
+	else if (policy == PARALLEL)
+		JobSystem::get().parallelFor(0, count, 0, [&](int from, int to) { f((unsigned int)from, (unsigned int)to); });
+	else
+	{
+		int chunks = (count + PIXEL_CHUNK_SIZE - 1) / PIXEL_CHUNK_SIZE;
+		JobSystem::get().parallelFor(0, chunks, 0, [&](int from, int to) {
+			unsigned int end = to * PIXEL_CHUNK_SIZE;
+			f(from * PIXEL_CHUNK_SIZE, end < count ? end : count);
+		});
+	}
+}
+
+//the pixels are allocated aligned to the cache lines, so the rows and tiles start at the beginning of a line
+#define IMAGE_ALIGNMENT 64
+void* alignedAlloc(size_t size);
+void alignedFree(void* data);
+template <typename T> T* allocatePixels(unsigned int count) { return (T*)alignedAlloc(count * sizeof(T)); }
+inline void freePixels(void* pixels) { alignedFree(pixels); }
+
+//a rectangle of pixels of an image, it doesn't own them (the image must outlive it and not be resized)
+//stride is the distance in pixels from the start of a row to the next one, so a part of an image is a view, not a copy
+class ImageView
+{
+public:
+	Color* pixels;
+	unsigned int width;
+	unsigned int height;
+	unsigned int stride;
+
+	ImageView() { pixels = NULL; width = height = stride = 0; }
+	ImageView(Color* pixels, unsigned int width, unsigned int height, unsigned int stride) { this->pixels = pixels; this->width = width; this->height = height; this->stride = stride; }
+
+	bool isEmpty() const { return !width || !height; }
+
+	Color* getRow(unsigned int y) const { return pixels + y * stride; }
+	unsigned int index(unsigned int x, unsigned int y) const { return y * stride + x; } //as Image::index
+	Color getPixel(unsigned int x, unsigned int y) const { return pixels[ y * stride + x ]; }
+	Color& getPixelRef(unsigned int x, unsigned int y) const { return pixels[ y * stride + x ]; }
+	inline void setPixel(unsigned int x, unsigned int y, const Color& c) const { pixels[ y * stride + x ] = c; }
+
+	//a part of this view, clipped to it
+	ImageView getArea(unsigned int x, unsigned int y, unsigned int width, unsigned int height) const;
+
+	//fill the view with the color C
+	void fill(const Color& c) const;
+
+	#ifndef IGNORE_LAMBDAS
+
+	//same as Image::forEachPixel, only for the pixels of the view
+	template <typename F>
+	const ImageView& forEachPixel( F callback ) const { return forEachPixel(SEQUENTIAL, callback); }
+
+	template <typename F>
+	const ImageView& forEachPixel( ExecutionPolicy policy, F callback ) const
+	{
+		return forEachRow(policy, [&](unsigned int y, Color* row) {
+			for(unsigned int x = 0; x < width; ++x)
+				row[x] = callback(row[x]);
+		});
+	}
+
+	//callback(y, row) for every row, the row has width pixels
+	template <typename F>
+	const ImageView& forEachRow( ExecutionPolicy policy, F callback ) const
+	{
+		if (width * height < PIXEL_PARALLEL_MIN)
+			policy = SEQUENTIAL;
+		forEachRange(policy == SEQUENTIAL ? SEQUENTIAL : PARALLEL, height, [&](unsigned int from, unsigned int to) {
+			for(unsigned int y = from; y < to; ++y)
+				callback(y, getRow(y));
+		});
+		return *this;
+	}
+
+	#endif
+
+	//copies img with its top-left corner at x,y, the part outside of the view is discarded
+	void drawImage(const ImageView& img, unsigned int x = 0, unsigned int y = 0) const;
+
+	//the coordinates are relative to the view and the pixels outside of it are discarded
+	void drawLine(int x0, int y0, int x1, int y1, const Color& color) const;
+	void fillTriangle(const Vector3& v0, const Vector3& v1, const Vector3& v2, const Color& color) const;
+	void fillInterpolatedTriangle(const Vector3& v0, const Vector3& v1, const Vector3& v2, const Color& c0, const Color& c1, const Color& c2) const;
+};
 
 //Class Image: to store a matrix of pixels
 class Image
@@ -40,41 +182,67 @@ public:
 	unsigned int width;
 	unsigned int height;
 	Color* pixels;
-	RasterInfo* raster;
+	PixelLayout layout;
+	unsigned int tiles_x; //blocks per row when the layout is TILED
 
 	// CONSTRUCTORS 
 	Image();
-	Image(unsigned int width, unsigned int height);
+	Image(unsigned int width, unsigned int height, PixelLayout layout = LINEAR);
 	Image(const Image& c);
+	Image(Image&& c); //takes the pixels of c, that ends empty
+	explicit Image(const ImageView& view); //copies the pixels of the view (linear)
 	Image& operator = (const Image& c); //assign operator
+	Image& operator = (Image&& c);
 
 	//destructor
 	~Image();
 
+	//position of the pixel x,y inside the pixels array
+	unsigned int index(unsigned int x, unsigned int y) const { return pixelIndex(layout, width, tiles_x, x, y); }
+	unsigned int storageSize() const { return pixelStorageSize(layout, width, height); }
+
 	//get the pixel at position x,y
-	Color getPixel(unsigned int x, unsigned int y) const { return pixels[ y * width + x ]; }
-	Color& getPixelRef(unsigned int x, unsigned int y)	{ return pixels[ y * width + x ]; }
+	Color getPixel(unsigned int x, unsigned int y) const { return pixels[ index(x, y) ]; }
+	Color& getPixelRef(unsigned int x, unsigned int y)	{ return pixels[ index(x, y) ]; }
 	Color getPixelSafe(unsigned int x, unsigned int y) const {	
 		x = clamp((unsigned int)x, 0, width-1); 
 		y = clamp((unsigned int)y, 0, height-1); 
-		return pixels[ y * width + x ]; 
+		return pixels[ index(x, y) ]; 
 	}
 
 	//set the pixel at position x,y with value C
-	inline void setPixel(unsigned int x, unsigned int y, const Color& c) { pixels[ y * width + x ] = c; }
-	inline void setPixelSafe(unsigned int x, unsigned int y, const Color& c) const { x = clamp(x, 0, width-1); y = clamp(y, 0, height-1); pixels[ y * width + x ] = c; }
+	inline void setPixel(unsigned int x, unsigned int y, const Color& c) { pixels[ index(x, y) ] = c; }
+	inline void setPixelSafe(unsigned int x, unsigned int y, const Color& c) const { x = clamp(x, 0, width-1); y = clamp(y, 0, height-1); pixels[ index(x, y) ] = c; }
+
+	//changes how the pixels are stored, the content is kept
+	void setLayout(PixelLayout layout);
+
+	//writes the pixels row after row in dest (width*height colors), whatever the layout is
+	void copyToLinear(Color* dest) const;
+
+	//the width pixels of the row y, scratch (width colors) is used to put them together when the layout is TILED
+	const Color* readRow(unsigned int y, Color* scratch) const;
+	//replaces the row y with the width colors of row
+	void writeRow(unsigned int y, const Color* row);
+	//fills the pixels x0 to x1 (inclusive) of the row y, with wide stores where the pixels are together in memory
+	void fillSpan(unsigned int y, unsigned int x0, unsigned int x1, const Color& c);
 
 	void resize(unsigned int width, unsigned int height);
-	void scale(unsigned int width, unsigned int height);
+	void scale(unsigned int width, unsigned int height, ResampleFilter filter = RESAMPLE_BILINEAR);
 	
 	void flipY(); //flip the image top-down
 	void flipX(); //flip the image left-right
 
 	//fill the image with the color C
-	void fill(const Color& c) { for(unsigned int pos = 0; pos < width*height; ++pos) pixels[pos] = c; }
+	void fill(const Color& c) { unsigned int size = storageSize(); for(unsigned int pos = 0; pos < size; ++pos) pixels[pos] = c; }
+
+	//the pixels of the image (or a part of it) without copying them, only for the LINEAR layout (empty if TILED)
+	ImageView getView() const { return getView(0, 0, width, height); }
+	ImageView getView(unsigned int x, unsigned int y, unsigned int width, unsigned int height) const;
 
 	//returns a new image with the area from (startx,starty) of size width,height
 	Image getArea(unsigned int start_x, unsigned int start_y, unsigned int width, unsigned int height);
+	void getArea(unsigned int start_x, unsigned int start_y, unsigned int width, unsigned int height, Image& result) const; //reuses the pixels of result
 
 	//save or load images from the hard drive
 	bool loadTGA(const char* filename);
@@ -89,11 +257,56 @@ public:
 	template <typename F>
 	Image& forEachPixel( F callback )
 	{
-		for(unsigned int pos = 0; pos < width*height; ++pos)
+		unsigned int size = storageSize();
+		for(unsigned int pos = 0; pos < size; ++pos)
 			pixels[pos] = callback(pixels[pos]);
 		return *this;
 	}
 
+	//same, run as the policy says (the callback must be safe to call from several threads)
+	//   img.forEachPixel( PARALLEL_CHUNKED, [](Color c) { return c*2; });
+	template <typename F>
+	Image& forEachPixel( ExecutionPolicy policy, F callback )
+	{
+		unsigned int size = storageSize();
+		if (size < PIXEL_PARALLEL_MIN)
+			policy = SEQUENTIAL;
+		bool chunked = policy == PARALLEL_CHUNKED;
+		forEachRange(policy, size, [&](unsigned int from, unsigned int to) {
+			if (chunked)
+				for(; from + PIXEL_CHUNK_SIZE <= to; from += PIXEL_CHUNK_SIZE)
+				{
+					Color* chunk = pixels + from;
+					for(unsigned int i = 0; i < PIXEL_CHUNK_SIZE; ++i)
+						chunk[i] = callback(chunk[i]);
+				}
+			for(unsigned int pos = from; pos < to; ++pos)
+				pixels[pos] = callback(pixels[pos]);
+		});
+		return *this;
+	}
+
+	//callback(y, row) for every row, only for the LINEAR layout (use forEachTile with TILED)
+	template <typename F>
+	Image& forEachRow( ExecutionPolicy policy, F callback ) { getView().forEachRow(policy, callback); return *this; }
+
+	//callback(x, y, tile) for every tile of PIXEL_TILE_SIZE x PIXEL_TILE_SIZE pixels, x,y is its top-left pixel
+	//only for the TILED layout, the tiles on the right and bottom borders also have the pixels outside of the image
+	template <typename F>
+	Image& forEachTile( ExecutionPolicy policy, F callback )
+	{
+		if (layout != TILED)
+			return *this;
+		unsigned int tiles = tiles_x * ((height + PIXEL_TILE_MASK) >> PIXEL_TILE_BITS);
+		if (storageSize() < PIXEL_PARALLEL_MIN)
+			policy = SEQUENTIAL;
+		forEachRange(policy == SEQUENTIAL ? SEQUENTIAL : PARALLEL, tiles, [&](unsigned int from, unsigned int to) {
+			for(unsigned int tile = from; tile < to; ++tile)
+				callback((tile % tiles_x) << PIXEL_TILE_BITS, (tile / tiles_x) << PIXEL_TILE_BITS, pixels + (tile << (2 * PIXEL_TILE_BITS)));
+		});
+		return *this;
+	}
+
 	#endif
 
 /* my stuff */
@@ -112,10 +325,16 @@ public:
 		const Vector3& v0, const Vector3& v1, const Vector3& v2,
 		Vector2 t0, Vector2 t1, Vector2 t2
 	);
+	void fillTexturedTriangle(
+		FloatImage* z_buffer,
+		const Sampler* sampler,
+		const Vector3& v0, const Vector3& v1, const Vector3& v2,
+		Vector2 t0, Vector2 t1, Vector2 t2
+	);
 
 private:
-	void _clearRaster();
-	void _rasterTriangleLine(int x0, int y0, int x1, int y1);
+	RasterInfo* _clearRaster(); //from the frame arena
+	void _rasterTriangleLine(RasterInfo* raster, int x0, int y0, int x1, int y1);
 
 	static Vector3 _weights(int x, int y, const Vector2& p0, const Vector2& p1, const Vector2& p2);
 	static Color _interpolatedColor(
@@ -128,34 +347,91 @@ private:
 };
 
 //Image that stores one float per pixel instead of a Color, like a matrix, useful for a Depth Buffer
+//it can also store several floats per pixel, useful for the depth of every sample when multisampling
 class FloatImage
 {
 public:
 	unsigned int width;
 	unsigned int height;
 	float* pixels;
+	PixelLayout layout;
+	unsigned int tiles_x; //blocks per row when the layout is TILED
+	unsigned int samples; //values per pixel, stored one after the other
 
 	// CONSTRUCTORS 
-	FloatImage() { width = height = 0; pixels = NULL; }
-	FloatImage(unsigned int width, unsigned int height);
+	FloatImage() { width = height = 0; pixels = NULL; layout = LINEAR; tiles_x = 0; samples = 1; }
+	FloatImage(unsigned int width, unsigned int height, PixelLayout layout = LINEAR, unsigned int samples = 1);
 	FloatImage(const FloatImage& c);
+	FloatImage(FloatImage&& c);
 	FloatImage& operator = (const FloatImage& c); //assign operator
+	FloatImage& operator = (FloatImage&& c);
 
 	//destructor
 	~FloatImage();
 
-	void fill(const float& v) { for(unsigned int pos = 0; pos < width*height; ++pos) pixels[pos] = v; }
+	void fill(const float& v) { unsigned int size = storageSize(); for(unsigned int pos = 0; pos < size; ++pos) pixels[pos] = v; }
 
-	//get the pixel at position x,y
-	float getPixel(unsigned int x, unsigned int y) const { return pixels[y * width + x]; }
-	float& getPixelRef(unsigned int x, unsigned int y) { return pixels[y * width + x]; }
+	//position of the pixel x,y (its first sample) inside the pixels array
+	unsigned int index(unsigned int x, unsigned int y) const { return pixelIndex(layout, width, tiles_x, x, y) * samples; }
+	unsigned int storageSize() const { return pixelStorageSize(layout, width, height) * samples; }
+
+	//get the pixel at position x,y (the first sample when there are several)
+	float getPixel(unsigned int x, unsigned int y) const { return pixels[index(x, y)]; }
+	float& getPixelRef(unsigned int x, unsigned int y) { return pixels[index(x, y)]; }
 
 	//set the pixel at position x,y with value C
-	inline void setPixel(unsigned int x, unsigned int y, const float& v) { pixels[y * width + x] = v; }
+	inline void setPixel(unsigned int x, unsigned int y, const float& v) { pixels[index(x, y)] = v; }
+
+	//access to every sample of the pixel x,y
+	float getSample(unsigned int x, unsigned int y, unsigned int sample) const { return pixels[index(x, y) + sample]; }
+	float& getSampleRef(unsigned int x, unsigned int y, unsigned int sample) { return pixels[index(x, y) + sample]; }
+	inline void setSample(unsigned int x, unsigned int y, unsigned int sample, const float& v) { pixels[index(x, y) + sample] = v; }
+
+	//changes how the pixels are stored, the content is kept
+	void setLayout(PixelLayout layout);
 
 	void resize(unsigned int width, unsigned int height);
 };
 
+#ifndef IGNORE_LAMBDAS
 
+//you can apply and algorithm for two images and store the result in the first one (they must have the same size)
+//forEachPixel( img, img2, [](Color a, Color b) { return a + b; } );
+template <typename F>
+void forEachPixel(ExecutionPolicy policy, Image& img, const Image& img2, F f)
+{
+	if (img.layout != img2.layout)
+	{
+		//the pixels are not in the same order, row by row
+		if (img.width * img.height < PIXEL_PARALLEL_MIN)
+			policy = SEQUENTIAL;
+		forEachRange(policy == SEQUENTIAL ? SEQUENTIAL : PARALLEL, img.height, [&](unsigned int from, unsigned int to) {
+			for(unsigned int y = from; y < to; ++y)
+				for(unsigned int x = 0; x < img.width; ++x)
+					img.getPixelRef(x, y) = f( img.getPixel(x, y), img2.getPixel(x, y) );
+		});
+		return;
+	}
 
-#endif
\ No newline at end of file
+	unsigned int size = img.storageSize();
+	if (size < PIXEL_PARALLEL_MIN)
+		policy = SEQUENTIAL;
+	Color* a = img.pixels;
+	const Color* b = img2.pixels;
+	bool chunked = policy == PARALLEL_CHUNKED;
+	forEachRange(policy, size, [&](unsigned int from, unsigned int to) {
+		if (chunked)
+			for(; from + PIXEL_CHUNK_SIZE <= to; from += PIXEL_CHUNK_SIZE)
+				for(unsigned int i = from; i < from + PIXEL_CHUNK_SIZE; ++i)
+					a[i] = f( a[i], b[i] );
+		for(unsigned int pos = from; pos < to; ++pos)
+			a[pos] = f( a[pos], b[pos] );
+	});
+}
+
+template <typename F>
+void forEachPixel(Image& img, const Image& img2, F f) { forEachPixel(SEQUENTIAL, img, img2, f); }
+
+#endif
+
+#endif
@@ -0,0 +1,205 @@
+#include "jobs.h"
+
+//queue of the current thread, the threads that are not workers share the last one
+static thread_local int worker_index = -1;
+
+JobSystem::JobSystem(unsigned int num_threads)
+{
+	if (!num_threads)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		num_threads = cores > 1 ? cores - 1 : 1;
+	}
+
+	queued = 0;
+	stopping = false;
+	for (unsigned int i = 0; i <= num_threads; ++i)
+		queues.push_back(new Queue());
+	for (unsigned int i = 0; i < num_threads; ++i)
+		threads.push_back(std::thread(&JobSystem::workerLoop, this, i));
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		stopping = true;
+	}
+	wake_up.notify_all();
+	for (unsigned int i = 0; i < threads.size(); ++i)
+		threads[i].join();
+	for (unsigned int i = 0; i < queues.size(); ++i)
+		delete queues[i];
+}
+
+JobSystem& JobSystem::get()
+{
+	static JobSystem system;
+	return system;
+}
+
+void JobSystem::push(const Item& item)
+{
+	Queue* queue = queues[worker_index >= 0 ? worker_index : queues.size() - 1];
+	{
+		std::unique_lock<std::mutex> lock(queue->mutex);
+		queue->items.push_back(item);
+	}
+	{
+		//under the lock, so a worker can't miss it between checking queued and going to sleep
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		queued++;
+	}
+	wake_up.notify_one();
+}
+
+//the newest job of our queue or the oldest of another one
+bool JobSystem::pop(Item& item)
+{
+	if (!queued)
+		return false;
+
+	unsigned int own = worker_index >= 0 ? worker_index : queues.size() - 1;
+	for (unsigned int i = 0; i < queues.size(); ++i)
+	{
+		Queue* queue = queues[(own + i) % queues.size()];
+		std::unique_lock<std::mutex> lock(queue->mutex);
+		if (queue->items.empty())
+			continue;
+		if (i == 0)
+		{
+			item = queue->items.back();
+			queue->items.pop_back();
+		}
+		else
+		{
+			item = queue->items.front();
+			queue->items.pop_front();
+		}
+		queued--;
+		return true;
+	}
+	return false;
+}
+
+void JobSystem::execute(Item& item)
+{
+	item.job();
+	finish(item.counter);
+}
+
+void JobSystem::finish(JobCounter* counter)
+{
+	if (!counter)
+		return;
+
+	std::vector<std::function<void()> > continuations;
+	{
+		//the lock also keeps the counter alive until we are done with it (wait can't return before it is released)
+		std::unique_lock<std::mutex> lock(counter->mutex);
+		if (--counter->pending == 0)
+			continuations.swap(counter->continuations);
+	}
+	for (unsigned int i = 0; i < continuations.size(); ++i)
+		continuations[i]();
+}
+
+void JobSystem::run(const Job& job, JobCounter* counter)
+{
+	Item item;
+	item.job = job;
+	item.counter = counter;
+	if (counter)
+		counter->pending++;
+	push(item);
+}
+
+void JobSystem::runAfter(JobCounter& dependency, const Job& job, JobCounter* counter)
+{
+	if (counter)
+		counter->pending++;
+
+	Item item;
+	item.job = job;
+	item.counter = counter;
+	{
+		std::unique_lock<std::mutex> lock(dependency.mutex);
+		if (dependency.pending > 0)
+		{
+			dependency.continuations.push_back([this, item]() { push(item); });
+			return;
+		}
+	}
+	push(item);
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	Item item;
+	while (counter.pending > 0)
+	{
+		if (pop(item))
+			execute(item);
+		else
+			std::this_thread::yield(); //the last jobs are running in other threads
+	}
+
+	//the last job could still be releasing the counter
+	std::unique_lock<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::parallelFor(int begin, int end, int grain, const RangeJob& job)
+{
+	if (end <= begin)
+		return;
+
+	int count = end - begin;
+	if (grain <= 0)
+	{
+		//a few pieces per thread, so the ones that finish early can steal the rest
+		grain = count / (int)((threads.size() + 1) * 4);
+		if (grain < 1)
+			grain = 1;
+	}
+	if (count <= grain)
+	{
+		job(begin, end);
+		return;
+	}
+
+	JobCounter counter;
+	for (int from = begin + grain; from < end; from += grain)
+	{
+		int to = from + grain < end ? from + grain : end;
+		run([&job, from, to]() { job(from, to); }, &counter);
+	}
+	job(begin, begin + grain); //the first piece in this thread
+	wait(counter);
+}
+
+void* JobSystem::getScratch(size_t size)
+{
+	static thread_local std::vector<unsigned char> scratch;
+	if (scratch.size() < size)
+		scratch.resize(size);
+	return scratch.data();
+}
+
+void JobSystem::workerLoop(unsigned int index)
+{
+	worker_index = index;
+	Item item;
+	while (true)
+	{
+		if (pop(item))
+		{
+			execute(item);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		wake_up.wait(lock, [this] { return stopping || queued > 0; });
+		if (stopping)
+			break;
+	}
+}
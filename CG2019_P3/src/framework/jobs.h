@@ -0,0 +1,98 @@
+/*  Job system shared by the whole framework.
+	A fixed set of worker threads (one less than the cores, the thread that waits also works) takes the jobs.
+	Every worker has its own queue: it takes the last job it pushed (still in cache) and, when it runs out, steals
+	the oldest job of another queue. Waiting for a job runs other jobs meanwhile, so jobs can wait for jobs.
+	Every subsystem uses the same pool, so nested parallel loops don't create more threads than cores.
+*/
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+class JobSystem;
+
+//counts the jobs not finished yet of a group, other jobs can be launched when it reaches 0 (to build task graphs)
+class JobCounter
+{
+public:
+	JobCounter() { pending = 0; }
+	bool isDone() const { return pending == 0; }
+
+private:
+	friend class JobSystem;
+	std::atomic<int> pending;
+	std::mutex mutex;
+	std::vector<std::function<void()> > continuations; //queued when the counter gets to 0
+
+	JobCounter(const JobCounter&);
+	JobCounter& operator = (const JobCounter&);
+};
+
+class JobSystem
+{
+public:
+	typedef std::function<void()> Job;
+	//processes the range [from, to)
+	typedef std::function<void(int from, int to)> RangeJob;
+
+	//0 threads uses one less than the cores
+	JobSystem(unsigned int num_threads = 0);
+	~JobSystem();
+
+	//the one used by the framework, created the first time
+	static JobSystem& get();
+
+	//threads that run jobs, the ones waiting also run them
+	unsigned int getNumThreads() const { return (unsigned int)threads.size(); }
+
+	//queues the job, counter (optional) is increased now and decreased when the job finishes
+	void run(const Job& job, JobCounter* counter = NULL);
+	//queues the job when dependency gets to 0
+	void runAfter(JobCounter& dependency, const Job& job, JobCounter* counter = NULL);
+	//runs jobs until the counter gets to 0
+	void wait(JobCounter& counter);
+
+	//calls job with pieces of [begin, end) of grain elements (0 chooses it) in parallel and waits for all of them
+	void parallelFor(int begin, int end, int grain, const RangeJob& job);
+
+	//memory only for the thread calling it, grows when needed and is kept for the next calls (valid until the next call)
+	static void* getScratch(size_t size);
+
+private:
+	struct Item
+	{
+		Job job;
+		JobCounter* counter;
+	};
+
+	struct Queue
+	{
+		std::deque<Item> items;
+		std::mutex mutex;
+	};
+
+	std::vector<std::thread> threads;
+	std::vector<Queue*> queues; //one per worker, the last one for the threads that are not workers
+	std::atomic<unsigned int> queued; //items in all the queues
+	std::mutex sleep_mutex;
+	std::condition_variable wake_up;
+	bool stopping;
+
+	void push(const Item& item);
+	bool pop(Item& item);
+	void execute(Item& item);
+	void finish(JobCounter* counter);
+	void workerLoop(unsigned int index);
+
+	JobSystem(const JobSystem&);
+	JobSystem& operator = (const JobSystem&);
+};
+
+#endif
@@ -0,0 +1,286 @@
+#include "lines.h"
+#include "rasterizer.h"
+#include "allocator.h"
+#include "jobs.h"
+#include <cmath>
+
+//rows of the framebuffer drawn by every job of drawLines
+#define LINES_BAND_ROWS 32
+
+#define SWAP(a, b) { auto __AUX__ = (a); (a) = (b); (b) = __AUX__; }
+
+enum
+{
+	CLIP_INSIDE = 0,
+	CLIP_LEFT = 1,
+	CLIP_RIGHT = 2,
+	CLIP_TOP = 4,
+	CLIP_BOTTOM = 8
+};
+
+static int getOutCode(float x, float y, float min_x, float min_y, float max_x, float max_y)
+{
+	int code = CLIP_INSIDE;
+	if (x < min_x) code |= CLIP_LEFT;
+	else if (x > max_x) code |= CLIP_RIGHT;
+	if (y < min_y) code |= CLIP_TOP;
+	else if (y > max_y) code |= CLIP_BOTTOM;
+	return code;
+}
+
+bool clipLine(float& x0, float& y0, float& x1, float& y1, float min_x, float min_y, float max_x, float max_y)
+{
+	int code0 = getOutCode(x0, y0, min_x, min_y, max_x, max_y);
+	int code1 = getOutCode(x1, y1, min_x, min_y, max_x, max_y);
+	while (true)
+	{
+		if (!(code0 | code1))
+			return true; //inside
+		if (code0 & code1)
+			return false; //both on the same side of one of the borders
+
+		//moves the point that is outside to the border it crosses
+		int code = code0 ? code0 : code1;
+		float x, y;
+		if (code & CLIP_BOTTOM) { x = x0 + (x1 - x0) * (max_y - y0) / (y1 - y0); y = max_y; }
+		else if (code & CLIP_TOP) { x = x0 + (x1 - x0) * (min_y - y0) / (y1 - y0); y = min_y; }
+		else if (code & CLIP_RIGHT) { y = y0 + (y1 - y0) * (max_x - x0) / (x1 - x0); x = max_x; }
+		else { y = y0 + (y1 - y0) * (min_x - x0) / (x1 - x0); x = min_x; }
+
+		if (code == code0)
+		{
+			x0 = x; y0 = y;
+			code0 = getOutCode(x0, y0, min_x, min_y, max_x, max_y);
+		}
+		else
+		{
+			x1 = x; y1 = y;
+			code1 = getOutCode(x1, y1, min_x, min_y, max_x, max_y);
+		}
+	}
+}
+
+static inline long long floorDiv(long long a, long long b)
+{
+	long long q = a / b;
+	if ((a % b != 0) && ((a < 0) != (b < 0)))
+		q--;
+	return q;
+}
+
+static inline long long ceilDiv(long long a, long long b) { return -floorDiv(-a, b); }
+
+//the pixels of the line inside the rectangle (inclusive), the endpoints can be outside of it
+//along the major axis u the minor one is v(u) = v0 + round((u - u0) * dv / du), so the range of u with v inside is computed
+//from the inequalities and every pixel of the loop is inside. T is an Image (any layout) or an ImageView
+template <class T>
+static void drawSegment(const T& img, int x0, int y0, int x1, int y1, const Color& color, int min_x, int min_y, int max_x, int max_y)
+{
+	bool steep = abs(y1 - y0) > abs(x1 - x0);
+	if (steep)
+	{
+		SWAP(x0, y0); SWAP(x1, y1);
+		SWAP(min_x, min_y); SWAP(max_x, max_y);
+	}
+	if (x0 > x1)
+	{
+		SWAP(x0, x1); SWAP(y0, y1);
+	}
+
+	long long du = x1 - x0, dv = y1 - y0;
+	long long first = x0 > min_x ? x0 : min_x;
+	long long last = x1 < max_x ? x1 : max_x;
+	long long denom = 2 * du;
+	if (du == 0 || dv == 0)
+	{
+		if (y0 < min_y || y0 > max_y)
+			return;
+	}
+	else
+	{
+		//v >= min_y  <=>  (u - u0) * 2dv >= (min_y - v0) * 2du - du
+		//v <= max_y  <=>  (u - u0) * 2dv <= (max_y - v0 + 1) * 2du - du - 1
+		long long slope = 2 * dv;
+		long long k_min = (min_y - y0) * denom - du;
+		long long k_max = (max_y - y0 + 1) * denom - du - 1;
+		long long t_min, t_max;
+		if (slope > 0)
+		{
+			t_min = ceilDiv(k_min, slope);
+			t_max = floorDiv(k_max, slope);
+		}
+		else
+		{
+			t_min = ceilDiv(k_max, slope);
+			t_max = floorDiv(k_min, slope);
+		}
+		if (x0 + t_min > first) first = x0 + t_min;
+		if (x0 + t_max < last) last = x0 + t_max;
+	}
+	if (first > last)
+		return;
+
+	if (du == 0)
+	{
+		img.pixels[steep ? img.index(y0, x0) : img.index(x0, y0)] = color;
+		return;
+	}
+
+	//Bresenham from the first pixel inside, error in [0, 2du)
+	long long num = (first - x0) * 2 * dv + du;
+	long long v = y0 + floorDiv(num, denom);
+	long long error = num - (v - y0) * denom;
+	long long step = 2 * dv;
+	for (long long u = first; u <= last; ++u)
+	{
+		img.pixels[steep ? img.index((unsigned int)v, (unsigned int)u) : img.index((unsigned int)u, (unsigned int)v)] = color;
+		error += step;
+		if (error >= denom) { error -= denom; v++; }
+		else if (error < 0) { error += denom; v--; }
+	}
+}
+
+static inline int roundToInt(float v) { return (int)floorf(v + 0.5f); }
+
+void drawLine(Image& img, int x0, int y0, int x1, int y1, const Color& color)
+{
+	if (!img.width || !img.height)
+		return;
+	drawSegment(img, x0, y0, x1, y1, color, 0, 0, img.width - 1, img.height - 1);
+}
+
+void drawLine(const ImageView& view, int x0, int y0, int x1, int y1, const Color& color)
+{
+	if (view.isEmpty())
+		return;
+	drawSegment(view, x0, y0, x1, y1, color, 0, 0, view.width - 1, view.height - 1);
+}
+
+static inline void blendPixel(Color& pixel, const Color& color, float alpha)
+{
+	pixel.r = (unsigned char)(pixel.r + (color.r - pixel.r) * alpha);
+	pixel.g = (unsigned char)(pixel.g + (color.g - pixel.g) * alpha);
+	pixel.b = (unsigned char)(pixel.b + (color.b - pixel.b) * alpha);
+}
+
+void drawLineAA(Image& img, float x0, float y0, float x1, float y1, const Color& color)
+{
+	if (!img.width || !img.height || !std::isfinite(x0 + y0 + x1 + y1) || !clipLine(x0, y0, x1, y1, 0, 0, img.width - 1.0f, img.height - 1.0f))
+		return;
+
+	bool steep = fabsf(y1 - y0) > fabsf(x1 - x0);
+	if (steep)
+	{
+		SWAP(x0, y0); SWAP(x1, y1);
+	}
+	if (x0 > x1)
+	{
+		SWAP(x0, x1); SWAP(y0, y1);
+	}
+
+	float gradient = x1 > x0 ? (y1 - y0) / (x1 - x0) : 0.0f;
+	int first = roundToInt(x0), last = roundToInt(x1);
+	unsigned int minor_size = steep ? img.width : img.height;
+	float v = y0 + gradient * (first - x0);
+	for (int u = first; u <= last; ++u, v += gradient)
+	{
+		//the second pixel goes out at the last row, and the rounding can move the first one a bit
+		int base = (int)floorf(v);
+		float coverage = v - base;
+		if ((unsigned int)base < minor_size)
+			blendPixel(img.pixels[steep ? img.index(base, u) : img.index(u, base)], color, 1.0f - coverage);
+		if ((unsigned int)(base + 1) < minor_size)
+			blendPixel(img.pixels[steep ? img.index(base + 1, u) : img.index(u, base + 1)], color, coverage);
+	}
+}
+
+void drawThickLine(Image& img, float x0, float y0, float x1, float y1, float thickness, const Color& color)
+{
+	float dx = x1 - x0, dy = y1 - y0;
+	float length = sqrtf(dx * dx + dy * dy);
+	if (thickness <= 1.0f || length == 0)
+	{
+		drawLine(img, roundToInt(x0), roundToInt(y0), roundToInt(x1), roundToInt(y1), color);
+		return;
+	}
+
+	//the normal to the segment, half of the width to each side
+	float nx = -dy / length * thickness * 0.5f;
+	float ny = dx / length * thickness * 0.5f;
+	Vector3 a(x0 + nx, y0 + ny, 0), b(x1 + nx, y1 + ny, 0);
+	Vector3 c(x1 - nx, y1 - ny, 0), d(x0 - nx, y0 - ny, 0);
+
+	//the fill rule draws the pixels of the diagonal once
+	RasterTriangle tri;
+	auto fragment = [&](int x, int y, float, float, float) { img.setPixel(x, y, color); };
+	if (tri.setup(a, b, c, img.width, img.height))
+		tri.traverse(fragment);
+	if (tri.setup(a, c, d, img.width, img.height))
+		tri.traverse(fragment);
+}
+
+struct LineSegment
+{
+	int x0, y0, x1, y1;
+	int min_y, max_y;
+};
+
+void drawLines(Image& img, const Vector2* points, unsigned int num_segments, const Color& color)
+{
+	if (!img.width || !img.height || !num_segments)
+		return;
+
+	Arena& arena = Arena::getFrame();
+	ArenaScope scope(arena);
+	LineSegment* segments = arena.allocateArray<LineSegment>(num_segments);
+
+	//clipped once (a pixel around the image, so the rounding doesn't move the visible pixels), the bands only cut rows
+	unsigned int count = 0;
+	const float max_x = (float)img.width, max_y = (float)img.height;
+	for (unsigned int i = 0; i < num_segments; ++i)
+	{
+		float x0 = points[2 * i].x, y0 = points[2 * i].y;
+		float x1 = points[2 * i + 1].x, y1 = points[2 * i + 1].y;
+		if (!std::isfinite(x0 + y0 + x1 + y1) || !clipLine(x0, y0, x1, y1, -1.0f, -1.0f, max_x, max_y))
+			continue;
+		LineSegment& s = segments[count++];
+		s.x0 = roundToInt(x0); s.y0 = roundToInt(y0);
+		s.x1 = roundToInt(x1); s.y1 = roundToInt(y1);
+		s.min_y = s.y0 < s.y1 ? s.y0 : s.y1;
+		s.max_y = s.y0 < s.y1 ? s.y1 : s.y0;
+	}
+
+	int num_bands = (img.height + LINES_BAND_ROWS - 1) / LINES_BAND_ROWS;
+	JobSystem::get().parallelFor(0, num_bands, 1, [&](int first_band, int last_band) {
+		int from_y = first_band * LINES_BAND_ROWS;
+		int to_y = std::min(last_band * LINES_BAND_ROWS, (int)img.height) - 1;
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			const LineSegment& s = segments[i];
+			if (s.max_y < from_y || s.min_y > to_y)
+				continue;
+			drawSegment(img, s.x0, s.y0, s.x1, s.y1, color, 0, from_y, img.width - 1, to_y);
+		}
+	});
+}
+
+void drawWireframe(Image& img, const VertexStream& positions, const Color& color)
+{
+	unsigned int num_triangles = positions.size() / 3;
+	Arena& arena = Arena::getFrame();
+	ArenaScope scope(arena);
+	Vector2* points = arena.allocateArray<Vector2>(num_triangles * 6);
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < num_triangles * 3; i += 3)
+	{
+		//w keeps 1/w, negative behind the camera
+		if (positions.w[i] <= 0 || positions.w[i + 1] <= 0 || positions.w[i + 2] <= 0)
+			continue;
+		Vector2* edges = points + count * 6;
+		edges[0].set(positions.x[i], positions.y[i]); edges[1].set(positions.x[i + 1], positions.y[i + 1]);
+		edges[2].set(positions.x[i + 1], positions.y[i + 1]); edges[3].set(positions.x[i + 2], positions.y[i + 2]);
+		edges[4].set(positions.x[i + 2], positions.y[i + 2]); edges[5].set(positions.x[i], positions.y[i]);
+		count++;
+	}
+	drawLines(img, points, count * 3, color);
+}
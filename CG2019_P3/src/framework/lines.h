@@ -0,0 +1,33 @@
+/*  Lines.
+	The segments are clipped once against the image (Cohen-Sutherland) and the range of pixels inside the clip rectangle
+	is computed exactly from the line equation, so the loops that write the pixels don't check the bounds.
+	The pixels are the same as Bresenham: the one nearest to the line in every column (or row, for steep lines).
+	Many segments (a wireframe) are drawn in parallel by bands of rows, every band only touches its own rows.
+*/
+
+#ifndef LINES_H
+#define LINES_H
+
+#include "image.h"
+#include "transform.h"
+
+//clips the segment to the rectangle (inclusive), returns false if nothing of it is inside
+bool clipLine(float& x0, float& y0, float& x1, float& y1, float min_x, float min_y, float max_x, float max_y);
+
+void drawLine(Image& img, int x0, int y0, int x1, int y1, const Color& color);
+void drawLine(const ImageView& view, int x0, int y0, int x1, int y1, const Color& color);
+
+//anti-aliased (Wu), every column (or row) of the line covers two pixels blended with the distance to them
+void drawLineAA(Image& img, float x0, float y0, float x1, float y1, const Color& color);
+
+//the rectangle around the segment with that width in pixels, filled with the triangle rasterizer
+void drawThickLine(Image& img, float x0, float y0, float x1, float y1, float thickness, const Color& color);
+
+//segments as pairs of points (points has 2 * num_segments), in parallel
+void drawLines(Image& img, const Vector2* points, unsigned int num_segments, const Color& color);
+
+//the edges of the triangles (every 3 vertices, as the meshes store them) already in pixels (see projectPositions), in parallel
+//the triangles with a vertex behind the camera are skipped
+void drawWireframe(Image& img, const VertexStream& positions, const Color& color);
+
+#endif
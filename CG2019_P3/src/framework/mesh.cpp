@@ -2,12 +2,14 @@
 #include <cassert>
 #include "includes.h"
 #include "camera.h"
+#include "allocator.h"
 
 #include <string>
 #include <sys/stat.h>
 
 
 std::vector<std::string> tokenize(const std::string& source, const char* delimiters, bool process_strings = false);
+int tokenizeLine(char* line, char** tokens, int max_tokens);
 Vector2 parseVector2(const char* text);
 Vector3 parseVector3(const char* text, const char separator);
 
@@ -76,8 +78,10 @@ bool Mesh::loadOBJ(const char* filename)
 
 	stat(filename,&stbuffer);
 
+	//the file and the tokens are freed when the load finishes
+	ArenaScope scope(Arena::getFrame());
 	unsigned int size = stbuffer.st_size;
-	char* data = new char[size+1];
+	char* data = Arena::getFrame().allocateArray<char>(size+1);
 	fread(data,size,1,f);
 	fclose(f);
 	data[size] = 0;
@@ -86,6 +90,10 @@ bool Mesh::loadOBJ(const char* filename)
 	char line[255];
 	int i = 0;
 
+	//a line of 255 chars can't have more tokens than this
+	const int max_tokens = 128;
+	char** tokens = Arena::getFrame().allocateArray<char*>(max_tokens);
+
 	std::vector<Vector3> indexed_positions;
 	std::vector<Vector3> indexed_normals;
 	std::vector<Vector2> indexed_uvs;
@@ -111,41 +119,41 @@ bool Mesh::loadOBJ(const char* filename)
 		//std::cout << "Line: \"" << line << "\"" << std::endl;
 		if (*line == '#' || *line == 0) continue; //comment
 
-		//tokenize line
-		std::vector<std::string> tokens = tokenize(line," ");
+		//tokenize line (in place, the tokens point inside it)
+		int num_tokens = tokenizeLine(line, tokens, max_tokens);
 
-		if (tokens.empty()) continue;
+		if (num_tokens == 0) continue;
 
-		if (tokens[0] == "v" && tokens.size() == 4)
+		if (strcmp(tokens[0], "v") == 0 && num_tokens == 4)
 		{
-			Vector3 v( atof(tokens[1].c_str()), atof(tokens[2].c_str()), atof(tokens[3].c_str()) );
+			Vector3 v( atof(tokens[1]), atof(tokens[2]), atof(tokens[3]) );
 			indexed_positions.push_back(v);
 		}
-		else if (tokens[0] == "vt" && tokens.size() == 4)
+		else if (strcmp(tokens[0], "vt") == 0 && num_tokens == 4)
 		{
-			Vector2 v( atof(tokens[1].c_str()), 1.0 - atof(tokens[2].c_str()) );
+			Vector2 v( atof(tokens[1]), 1.0 - atof(tokens[2]) );
 			indexed_uvs.push_back(v);
 		}
-		else if (tokens[0] == "vn" && tokens.size() == 4)
+		else if (strcmp(tokens[0], "vn") == 0 && num_tokens == 4)
 		{
-			Vector3 v( atof(tokens[1].c_str()), atof(tokens[2].c_str()), atof(tokens[3].c_str()) );
+			Vector3 v( atof(tokens[1]), atof(tokens[2]), atof(tokens[3]) );
 			indexed_normals.push_back(v);
 		}
-		else if (tokens[0] == "s") //surface? it appears one time before the faces
+		else if (strcmp(tokens[0], "s") == 0) //surface? it appears one time before the faces
 		{
 			//process mesh
 			if (uvs.size() == 0 && indexed_uvs.size() )
 				uvs.resize(1);
 		}
-		else if (tokens[0] == "f" && tokens.size() >= 4)
+		else if (strcmp(tokens[0], "f") == 0 && num_tokens >= 4)
 		{
 			Vector3 v1,v2,v3;
-			v1 = parseVector3( tokens[1].c_str(), '/' );
+			v1 = parseVector3( tokens[1], '/' );
 
-			for (int iPoly = 2; iPoly < tokens.size() - 1; iPoly++)
+			for (int iPoly = 2; iPoly < num_tokens - 1; iPoly++)
 			{
-				v2 = parseVector3( tokens[iPoly].c_str(), '/' );
-				v3 = parseVector3( tokens[iPoly+1].c_str(), '/' );
+				v2 = parseVector3( tokens[iPoly], '/' );
+				v3 = parseVector3( tokens[iPoly+1], '/' );
 
 				vertices.push_back( indexed_positions[ unsigned int(v1.x) -1 ] );
 				vertices.push_back( indexed_positions[ unsigned int(v2.x) -1] );
@@ -174,6 +182,24 @@ bool Mesh::loadOBJ(const char* filename)
 }
 
 
+//splits the line by spaces and tabs without copying it: the delimiters become 0 and tokens point to the words
+int tokenizeLine(char* line, char** tokens, int max_tokens)
+{
+	int num_tokens = 0;
+	char* pos = line;
+	while (*pos != 0 && num_tokens < max_tokens)
+	{
+		while (*pos == ' ' || *pos == '\t')
+			*pos++ = 0;
+		if (*pos == 0)
+			break;
+		tokens[num_tokens++] = pos;
+		while (*pos != 0 && *pos != ' ' && *pos != '\t')
+			pos++;
+	}
+	return num_tokens;
+}
+
 std::vector<std::string> tokenize(const std::string& source, const char* delimiters, bool process_strings )
 {
 	std::vector<std::string> tokens;
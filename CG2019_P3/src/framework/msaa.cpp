@@ -0,0 +1,75 @@
+#include "msaa.h"
+
+//rotated grid patterns, in 1/16 of pixel from the center (same ones GPUs use)
+static const int sample_pattern_4[] = { -2,-6,  6,-2,  -6,2,  2,6 };
+static const int sample_pattern_8[] = { 1,-3,  -1,3,  5,1,  -3,-5,  -5,5,  -7,-1,  3,7,  7,-7 };
+
+MultisampleBuffer::MultisampleBuffer()
+{
+	width = height = 0;
+	samples = 4;
+	reversed_z = false;
+	colors = NULL;
+}
+
+MultisampleBuffer::MultisampleBuffer(unsigned int width, unsigned int height, unsigned int samples, bool reversed_z)
+{
+	colors = NULL;
+	this->reversed_z = reversed_z;
+	create(width, height, samples);
+}
+
+MultisampleBuffer::~MultisampleBuffer()
+{
+	if (colors)
+		delete[] colors;
+}
+
+void MultisampleBuffer::create(unsigned int width, unsigned int height, unsigned int samples)
+{
+	if (colors)
+		delete[] colors;
+
+	this->width = width;
+	this->height = height;
+	this->samples = samples > 4 ? 8 : 4;
+	colors = new Color[width * height * this->samples];
+	depth = FloatImage(width, height, LINEAR, this->samples);
+}
+
+const int* MultisampleBuffer::getSamplePattern(unsigned int samples)
+{
+	return samples > 4 ? sample_pattern_8 : sample_pattern_4;
+}
+
+void MultisampleBuffer::clear(const Color& color)
+{
+	unsigned int size = width * height * samples;
+	for (unsigned int pos = 0; pos < size; ++pos)
+		colors[pos] = color;
+	depth.fill(reversed_z ? 0.f : FLT_MAX);
+}
+
+void MultisampleBuffer::resolve(Image& dest) const
+{
+	//samples is a power of two, so the average is a shift
+	const unsigned int shift = samples == 8 ? 3 : 2;
+	const unsigned int round = samples / 2;
+	const Color* sample_color = colors;
+
+	for (unsigned int y = 0; y < height; ++y)
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			unsigned int r = round, g = round, b = round;
+			for (unsigned int s = 0; s < samples; ++s, ++sample_color)
+			{
+				r += sample_color->r;
+				g += sample_color->g;
+				b += sample_color->b;
+			}
+			Color& c = dest.getPixelRef(x, y);
+			c.r = static_cast<unsigned char>(r >> shift);
+			c.g = static_cast<unsigned char>(g >> shift);
+			c.b = static_cast<unsigned char>(b >> shift);
+		}
+}
@@ -0,0 +1,123 @@
+/*  Multisample anti-aliasing for the software rasterizer.
+	The coverage and the depth are evaluated at 4 or 8 positions inside every pixel, but the pixel is shaded
+	only once and its color is copied to the samples that passed. resolve() averages the samples into an Image.
+*/
+
+#ifndef MSAA_H
+#define MSAA_H
+
+#include <cfloat>
+#include "framework.h"
+#include "image.h"
+#include "rasterizer.h"
+
+class MultisampleBuffer
+{
+public:
+	unsigned int width;
+	unsigned int height;
+	unsigned int samples;	//4 or 8
+	bool reversed_z;		//bigger z is closer (camera with reversed_z)
+	Color* colors;			//the colors of the samples of every pixel, one after the other, row after row
+	FloatImage depth;		//one depth per sample
+
+	MultisampleBuffer();
+	MultisampleBuffer(unsigned int width, unsigned int height, unsigned int samples = 4, bool reversed_z = false);
+	~MultisampleBuffer();
+
+	void create(unsigned int width, unsigned int height, unsigned int samples);
+	void resize(unsigned int width, unsigned int height) { create(width, height, samples); }
+
+	//sets all the samples to the color and the depth to the far plane
+	void clear(const Color& color);
+
+	//positions of the samples inside the pixel, pairs x,y in subpixels (1/16) from the pixel center
+	static const int* getSamplePattern(unsigned int samples);
+
+	//rasterizes the triangle, shade(w0, w1, w2) must return the color for the barycentric weights of the pixel center
+	//and it is called once per pixel with at least one visible sample
+	template <typename F>
+	void fillTriangle(const Vector3& v0, const Vector3& v1, const Vector3& v2, F shade);
+
+	//averages the samples of every pixel into dest (that must have the same size)
+	void resolve(Image& dest) const;
+
+private:
+	MultisampleBuffer(const MultisampleBuffer&);
+	MultisampleBuffer& operator = (const MultisampleBuffer&);
+};
+
+template <typename F>
+void MultisampleBuffer::fillTriangle(const Vector3& v0, const Vector3& v1, const Vector3& v2, F shade)
+{
+	//samples can be covered up to half a pixel away from the centers, so the box grows one pixel
+	RasterTriangle tri;
+	if (!tri.setup(v0, v1, v2, width, height, 1))
+		return;
+
+	const int* pattern = getSamplePattern(samples);
+
+	//offsets of the edge functions and the depth from the pixel center to every sample
+	long long offset0[8], offset1[8], offset2[8];
+	float offset_z[8];
+	Vector3 dw_dx, dw_dy;
+	tri.getWeightSteps(dw_dx, dw_dy);
+	float dz_dx = v0.z * dw_dx.x + v1.z * dw_dx.y + v2.z * dw_dx.z;
+	float dz_dy = v0.z * dw_dy.x + v1.z * dw_dy.y + v2.z * dw_dy.z;
+	for (unsigned int s = 0; s < samples; ++s)
+	{
+		int sx = pattern[s * 2], sy = pattern[s * 2 + 1];
+		offset0[s] = sx * (tri.step_x0 / SUBPIXEL_ONE) + sy * (tri.step_y0 / SUBPIXEL_ONE);
+		offset1[s] = sx * (tri.step_x1 / SUBPIXEL_ONE) + sy * (tri.step_y1 / SUBPIXEL_ONE);
+		offset2[s] = sx * (tri.step_x2 / SUBPIXEL_ONE) + sy * (tri.step_y2 / SUBPIXEL_ONE);
+		offset_z[s] = (sx * dz_dx + sy * dz_dy) / SUBPIXEL_ONE;
+	}
+
+	long long row0 = tri.e0, row1 = tri.e1, row2 = tri.e2;
+	for (int y = tri.min_y; y <= tri.max_y; ++y)
+	{
+		long long c0 = row0, c1 = row1, c2 = row2;
+		for (int x = tri.min_x; x <= tri.max_x; ++x)
+		{
+			//coverage mask, one bit per sample
+			unsigned int mask = 0;
+			for (unsigned int s = 0; s < samples; ++s)
+				if (((c0 + offset0[s]) | (c1 + offset1[s]) | (c2 + offset2[s])) >= 0)
+					mask |= 1 << s;
+
+			if (mask)
+			{
+				float w0 = c0 * tri.inv_area, w1 = c1 * tri.inv_area, w2 = c2 * tri.inv_area;
+				float z = v0.z * w0 + v1.z * w1 + v2.z * w2;
+				float* sample_depth = &depth.getPixelRef(x, y);
+
+				//depth test of every covered sample
+				unsigned int visible = 0;
+				for (unsigned int s = 0; s < samples; ++s)
+				{
+					float zs = z + offset_z[s];
+					if ((mask & (1 << s)) && (reversed_z ? zs > sample_depth[s] : zs < sample_depth[s]))
+					{
+						sample_depth[s] = zs;
+						visible |= 1 << s;
+					}
+				}
+
+				//shade once for all the samples
+				if (visible)
+				{
+					Color color = shade(w0, w1, w2);
+					Color* sample_color = colors + (y * width + x) * samples;
+					for (unsigned int s = 0; s < samples; ++s)
+						if (visible & (1 << s))
+							sample_color[s] = color;
+				}
+			}
+
+			c0 += tri.step_x0; c1 += tri.step_x1; c2 += tri.step_x2;
+		}
+		row0 += tri.step_y0; row1 += tri.step_y1; row2 += tri.step_y2;
+	}
+}
+
+#endif
@@ -0,0 +1,150 @@
+#include "pipeline.h"
+#include <chrono>
+
+FramePipeline::FramePipeline()
+{
+	rendering = 0;
+	running = false;
+	stopping = false;
+	width = height = 0;
+}
+
+FramePipeline::~FramePipeline()
+{
+	stop();
+}
+
+void FramePipeline::start(unsigned int num_buffers, unsigned int width, unsigned int height, PixelLayout layout)
+{
+	stop();
+
+	this->width = width;
+	this->height = height;
+	if (num_buffers < 2)
+		num_buffers = 2;
+	for (unsigned int i = 0; i < num_buffers; ++i)
+	{
+		Image* frame = new Image(width, height, layout);
+		frames.push_back(frame);
+		free_frames.push_back(frame);
+	}
+
+	stopping = false;
+	running = true;
+	worker = std::thread(&FramePipeline::workerLoop, this);
+}
+
+void FramePipeline::stop()
+{
+	if (!running)
+		return;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	changed.notify_all();
+	worker.join();
+
+	for (unsigned int i = 0; i < frames.size(); ++i)
+		delete frames[i];
+	frames.clear();
+	free_frames.clear();
+	finished_frames.clear();
+	running = false;
+}
+
+void FramePipeline::resize(unsigned int width, unsigned int height)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	//the frame being rendered must finish, the queued and finished ones are old so they are dropped (their buffers are free again)
+	for (unsigned int i = 0; i < jobs.size(); ++i)
+		free_frames.push_back(jobs[i].frame);
+	jobs.clear();
+	changed.wait(lock, [this] { return rendering == 0; });
+	for (unsigned int i = 0; i < finished_frames.size(); ++i)
+		free_frames.push_back(finished_frames[i]);
+	finished_frames.clear();
+
+	this->width = width;
+	this->height = height;
+	for (unsigned int i = 0; i < free_frames.size(); ++i)
+		free_frames[i]->resize(width, height);
+	changed.notify_all();
+}
+
+bool FramePipeline::canSubmit()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return !free_frames.empty();
+}
+
+bool FramePipeline::isBusy()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return !jobs.empty() || rendering || !finished_frames.empty();
+}
+
+void FramePipeline::submit(const RenderFunction& render)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	changed.wait(lock, [this] { return !free_frames.empty(); });
+
+	Job job;
+	job.frame = free_frames.front();
+	job.render = render;
+	free_frames.pop_front();
+
+	//a frame acquired during a resize still has the old size
+	if (job.frame->width != width || job.frame->height != height)
+		job.frame->resize(width, height);
+
+	jobs.push_back(job);
+	changed.notify_all();
+}
+
+Image* FramePipeline::acquire(unsigned int timeout)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (finished_frames.empty() && timeout)
+		changed.wait_for(lock, std::chrono::milliseconds(timeout), [this] { return !finished_frames.empty(); });
+	if (finished_frames.empty())
+		return NULL;
+
+	Image* frame = finished_frames.front();
+	finished_frames.pop_front();
+	return frame;
+}
+
+void FramePipeline::release(Image* frame)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	free_frames.push_back(frame);
+	changed.notify_all();
+}
+
+void FramePipeline::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		changed.wait(lock, [this] { return stopping || !jobs.empty(); });
+		if (stopping)
+			break;
+
+		Job job = jobs.front();
+		jobs.pop_front();
+		rendering = 1;
+
+		//render without the lock so the main thread can keep presenting
+		lock.unlock();
+		job.render(*job.frame);
+		lock.lock();
+
+		rendering = 0;
+		finished_frames.push_back(job.frame);
+		changed.notify_all();
+	}
+}
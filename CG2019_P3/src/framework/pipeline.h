@@ -0,0 +1,79 @@
+/*  Render and present in parallel.
+	A worker thread renders the frames into a small set of framebuffers while the main thread sends the previous
+	frame to the screen, so the time per frame gets close to the slowest of both instead of their sum.
+	With N buffers there are at most N-1 frames waiting to be shown, which bounds the latency.
+*/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "image.h"
+
+class FramePipeline
+{
+public:
+	//renders one frame in the image, runs in the worker thread so it can only read data that doesn't change meanwhile
+	typedef std::function<void(Image&)> RenderFunction;
+
+	FramePipeline();
+	~FramePipeline();
+
+	//creates the buffers (2 or 3) and launches the worker
+	void start(unsigned int num_buffers, unsigned int width, unsigned int height, PixelLayout layout = LINEAR);
+	//waits for the frame being rendered and stops the worker, the queued frames are discarded
+	void stop();
+	bool isRunning() const { return running; }
+
+	unsigned int getWidth() const { return width; }
+	unsigned int getHeight() const { return height; }
+
+	//changes the size of the buffers, waits for the worker and discards the frames not yet presented
+	void resize(unsigned int width, unsigned int height);
+
+	//true if there is a free buffer, so submit won't block
+	bool canSubmit();
+	//true if some frame is queued, being rendered or finished but not acquired yet
+	bool isBusy();
+
+	//queues a frame to be rendered, blocks while all the buffers are in use
+	void submit(const RenderFunction& render);
+
+	//the oldest finished frame, waiting up to timeout ms for it (0 doesn't wait). NULL if there is none
+	//the frame must be given back with release() after presenting it
+	Image* acquire(unsigned int timeout = 0);
+	void release(Image* frame);
+
+private:
+	struct Job
+	{
+		Image* frame;
+		RenderFunction render;
+	};
+
+	std::vector<Image*> frames;
+	std::deque<Image*> free_frames;
+	std::deque<Job> jobs;
+	std::deque<Image*> finished_frames;
+	unsigned int rendering; //frames the worker is rendering now (0 or 1)
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable changed; //signaled on every change of the queues
+	bool running;
+	bool stopping;
+	unsigned int width;
+	unsigned int height;
+
+	void workerLoop();
+
+	FramePipeline(const FramePipeline&);
+	FramePipeline& operator = (const FramePipeline&);
+};
+
+#endif
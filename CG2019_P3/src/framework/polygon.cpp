@@ -0,0 +1,135 @@
+#include "polygon.h"
+#include "allocator.h"
+#include <algorithm>
+#include <cmath>
+
+struct PolygonEdge
+{
+	int first_row, last_row;	//the rows whose center it crosses (inclusive), already inside the image
+	double x;					//at the center of the current row
+	double dx;					//change of x from one row to the next
+	int winding;				//1 going down, -1 going up
+};
+
+//false if the edge doesn't cross the center of any row of the image (horizontal, outside or not a number)
+static bool setupEdge(const Vector2& a, const Vector2& b, unsigned int height, PolygonEdge& edge)
+{
+	if (!std::isfinite(a.x + a.y + b.x + b.y) || a.y == b.y)
+		return false;
+	const Vector2& top = a.y < b.y ? a : b;
+	const Vector2& bottom = a.y < b.y ? b : a;
+
+	//the rows with the center (y + 0.5) in [top.y, bottom.y)
+	double first = ceil(top.y - 0.5), last = ceil(bottom.y - 0.5) - 1;
+	if (first < 0) first = 0;
+	if (last > height - 1.0) last = height - 1.0;
+	if (first > last)
+		return false;
+
+	edge.first_row = (int)first;
+	edge.last_row = (int)last;
+	edge.dx = ((double)bottom.x - top.x) / ((double)bottom.y - top.y);
+	edge.x = top.x + (first + 0.5 - top.y) * edge.dx;
+	edge.winding = a.y < b.y ? 1 : -1;
+	return true;
+}
+
+//the pixels with the center (x + 0.5) in [x0, x1)
+static void fillRowSpan(Image& img, int y, double x0, double x1, const Color& color)
+{
+	double first = ceil(x0 - 0.5), last = ceil(x1 - 0.5) - 1;
+	if (first < 0) first = 0;
+	if (last > img.width - 1.0) last = img.width - 1.0;
+	if (first <= last)
+		img.fillSpan(y, (unsigned int)first, (unsigned int)last, color);
+}
+
+void fillPolygon(Image& img, const Vector2* points, unsigned int num_points, const Color& color, FillRule rule)
+{
+	fillPolygon(img, points, &num_points, 1, color, rule);
+}
+
+void fillPolygon(Image& img, const Vector2* points, const unsigned int* counts, unsigned int num_contours, const Color& color, FillRule rule)
+{
+	if (!img.width || !img.height)
+		return;
+	unsigned int num_points = 0;
+	for (unsigned int i = 0; i < num_contours; ++i)
+		num_points += counts[i];
+	if (!num_points)
+		return;
+
+	Arena& arena = Arena::getFrame();
+	ArenaScope scope(arena);
+	PolygonEdge* edges = arena.allocateArray<PolygonEdge>(num_points);
+	unsigned int num_edges = 0;
+	const Vector2* contour = points;
+	for (unsigned int i = 0; i < num_contours; ++i)
+	{
+		for (unsigned int j = 0; j < counts[i]; ++j)
+			if (setupEdge(contour[j], contour[j + 1 < counts[i] ? j + 1 : 0], img.height, edges[num_edges]))
+				num_edges++;
+		contour += counts[i];
+	}
+	if (!num_edges)
+		return;
+
+	//edge table, by the first row
+	std::sort(edges, edges + num_edges, [](const PolygonEdge& a, const PolygonEdge& b) { return a.first_row < b.first_row; });
+	int last_row = edges[0].last_row;
+	for (unsigned int i = 1; i < num_edges; ++i)
+		if (edges[i].last_row > last_row)
+			last_row = edges[i].last_row;
+
+	PolygonEdge** active = arena.allocateArray<PolygonEdge*>(num_edges);
+	unsigned int num_active = 0, next = 0;
+	for (int y = edges[0].first_row; y <= last_row; ++y)
+	{
+		//the edges that ended leave the list and the ones that start in this row come in
+		unsigned int kept = 0;
+		for (unsigned int i = 0; i < num_active; ++i)
+			if (active[i]->last_row >= y)
+				active[kept++] = active[i];
+		num_active = kept;
+		if (!num_active && next < num_edges && edges[next].first_row > y)
+		{
+			//a gap between contours
+			y = edges[next].first_row - 1;
+			continue;
+		}
+		while (next < num_edges && edges[next].first_row <= y)
+			active[num_active++] = &edges[next++];
+
+		//by x, the order barely changes from one row to the next so the insertion sort is almost linear
+		for (unsigned int i = 1; i < num_active; ++i)
+		{
+			PolygonEdge* edge = active[i];
+			unsigned int j = i;
+			for (; j > 0 && active[j - 1]->x > edge->x; --j)
+				active[j] = active[j - 1];
+			active[j] = edge;
+		}
+
+		if (rule == FILL_EVEN_ODD)
+		{
+			for (unsigned int i = 0; i + 1 < num_active; i += 2)
+				fillRowSpan(img, y, active[i]->x, active[i + 1]->x, color);
+		}
+		else
+		{
+			int winding = 0;
+			double start = 0;
+			for (unsigned int i = 0; i < num_active; ++i)
+			{
+				if (!winding)
+					start = active[i]->x;
+				winding += active[i]->winding;
+				if (!winding)
+					fillRowSpan(img, y, start, active[i]->x, color);
+			}
+		}
+
+		for (unsigned int i = 0; i < num_active; ++i)
+			active[i]->x += active[i]->dx;
+	}
+}
@@ -0,0 +1,27 @@
+/*  Polygons.
+	Any polygon (concave, self-intersecting, with holes as more contours) is filled row by row: the edges are sorted by
+	the first row they cross (edge table) and every row keeps the list of edges that cross it sorted by x (active edges),
+	so the spans of the row come from walking that list once and are filled with Image::fillSpan.
+	A pixel is inside when its center is, a center on a left or top edge is inside and on a right or bottom one is not,
+	so polygons that share edges don't draw the same pixels twice.
+*/
+
+#ifndef POLYGON_H
+#define POLYGON_H
+
+#include "image.h"
+
+//which parts of a self-intersecting polygon (or with several contours) are inside
+enum FillRule
+{
+	FILL_EVEN_ODD,	//crossing an edge toggles, the overlaps and the contours inside others are holes
+	FILL_NONZERO	//inside while the edges around do not cancel, holes go in the opposite direction to their contour
+};
+
+//the last point is joined to the first one
+void fillPolygon(Image& img, const Vector2* points, unsigned int num_points, const Color& color, FillRule rule = FILL_NONZERO);
+
+//several contours filled together, counts has the number of points of every contour (they go one after the other in points)
+void fillPolygon(Image& img, const Vector2* points, const unsigned int* counts, unsigned int num_contours, const Color& color, FillRule rule = FILL_NONZERO);
+
+#endif
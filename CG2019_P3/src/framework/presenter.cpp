@@ -0,0 +1,183 @@
+#include "presenter.h"
+
+#ifndef __APPLE__
+REGISTER_GLEXT( void, glGenBuffersARB, GLsizei n, GLuint* buffers )
+REGISTER_GLEXT( void, glDeleteBuffersARB, GLsizei n, const GLuint* buffers )
+REGISTER_GLEXT( void, glBindBufferARB, GLenum target, GLuint buffer )
+REGISTER_GLEXT( void, glBufferDataARB, GLenum target, GLsizeiptrARB size, const void* data, GLenum usage )
+REGISTER_GLEXT( void*, glMapBufferARB, GLenum target, GLenum access )
+REGISTER_GLEXT( GLboolean, glUnmapBufferARB, GLenum target )
+#endif
+
+Presenter::Presenter()
+{
+	supported = false;
+	initialized = false;
+	texture = 0;
+	buffer = 0;
+	width = height = 0;
+}
+
+bool Presenter::init()
+{
+	if (initialized)
+		return supported;
+	initialized = true;
+
+#ifndef __APPLE__
+	IMPORT_GLEXT( glGenBuffersARB );
+	IMPORT_GLEXT( glDeleteBuffersARB );
+	IMPORT_GLEXT( glBindBufferARB );
+	IMPORT_GLEXT( glBufferDataARB );
+	IMPORT_GLEXT( glMapBufferARB );
+	IMPORT_GLEXT( glUnmapBufferARB );
+	supported = glGenBuffersARB && glDeleteBuffersARB && glBindBufferARB && glBufferDataARB && glMapBufferARB && glUnmapBufferARB;
+#else
+	supported = true;
+#endif
+	if (!supported)
+		return false;
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenBuffersARB(1, &buffer);
+	return true;
+}
+
+//the rows of the rectangle one after the other, tiled images are copied one tile row at a time
+void Presenter::copyRect(const Image& img, int min_x, int min_y, int max_x, int max_y, Color* dest)
+{
+	unsigned int w = max_x - min_x + 1;
+	for (int y = min_y; y <= max_y; ++y)
+	{
+		if (img.layout == LINEAR)
+		{
+			memcpy(dest, img.pixels + img.index(min_x, y), w * sizeof(Color));
+			dest += w;
+			continue;
+		}
+		for (int x = min_x; x <= max_x; )
+		{
+			unsigned int count = PIXEL_TILE_SIZE - (x & PIXEL_TILE_MASK);
+			if (count > (unsigned int)(max_x - x + 1))
+				count = max_x - x + 1;
+			memcpy(dest, img.pixels + img.index(x, y), count * sizeof(Color));
+			dest += count;
+			x += count;
+		}
+	}
+}
+
+void Presenter::upload(const Image& img)
+{
+	int rect[4] = { 0, 0, (int)img.width - 1, (int)img.height - 1 };
+	upload(img, rect, 1);
+}
+
+void Presenter::upload(const Image& img, const int* rects, unsigned int num_rects)
+{
+	if (!supported || !img.width || !img.height)
+		return;
+
+	int full[4] = { 0, 0, (int)img.width - 1, (int)img.height - 1 };
+	glBindTexture(GL_TEXTURE_2D, texture);
+	if (width != img.width || height != img.height)
+	{
+		//new size, the texture is created again and everything must be uploaded
+		width = img.width;
+		height = img.height;
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+		rects = full;
+		num_rects = 1;
+	}
+
+	//the rectangles must fit in the buffer (if they overlap they could need more than the whole image)
+	unsigned int total = 0;
+	for (unsigned int i = 0; i < num_rects; ++i)
+	{
+		const int* r = rects + i * 4;
+		total += (r[2] - r[0] + 1) * (r[3] - r[1] + 1);
+	}
+	if (total > width * height)
+	{
+		rects = full;
+		num_rects = 1;
+		total = width * height;
+	}
+	if (!total)
+	{
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return;
+	}
+
+	//orphan the buffer: the driver gives new memory if the old one is still being read, instead of waiting
+	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, buffer);
+	glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, width * height * sizeof(Color), NULL, GL_STREAM_DRAW_ARB);
+	Color* data = (Color*)glMapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY_ARB);
+	if (data)
+	{
+		//pack the rectangles one after the other
+		unsigned int offset = 0;
+		for (unsigned int i = 0; i < num_rects; ++i)
+		{
+			const int* r = rects + i * 4;
+			copyRect(img, r[0], r[1], r[2], r[3], data + offset);
+			offset += (r[2] - r[0] + 1) * (r[3] - r[1] + 1);
+		}
+		glUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB);
+
+		//the texture reads from the buffer (the pointer is an offset inside it)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		offset = 0;
+		for (unsigned int i = 0; i < num_rects; ++i)
+		{
+			const int* r = rects + i * 4;
+			int w = r[2] - r[0] + 1, h = r[3] - r[1] + 1;
+			glTexSubImage2D(GL_TEXTURE_2D, 0, r[0], r[1], w, h, GL_RGB, GL_UNSIGNED_BYTE, (const char*)NULL + offset * sizeof(Color));
+			offset += w * h;
+		}
+	}
+	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Presenter::draw()
+{
+	if (!supported || !width)
+		return;
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+	//the first row of the image is the bottom one, like in glDrawPixels
+	glBegin(GL_QUADS);
+		glTexCoord2f(0, 0); glVertex2f(-1, -1);
+		glTexCoord2f(1, 0); glVertex2f(1, -1);
+		glTexCoord2f(1, 1); glVertex2f(1, 1);
+		glTexCoord2f(0, 1); glVertex2f(-1, 1);
+	glEnd();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_TEXTURE_2D);
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
@@ -0,0 +1,43 @@
+/*  Sends the framebuffer to the screen.
+	The pixels are copied into a pixel buffer object (orphaned every frame, so the driver never has to wait for the
+	previous upload), the texture is updated from it asynchronously and drawn as a quad covering the window.
+	Only the rectangles that changed need to be uploaded, the texture keeps the rest.
+	If the graphics card has no pixel buffer objects it falls back to glDrawPixels.
+*/
+
+#ifndef PRESENTER_H
+#define PRESENTER_H
+
+#include "includes.h"
+#include "image.h"
+
+class Presenter
+{
+public:
+	Presenter();
+
+	//needs the OpenGL context, returns false if the pixel buffer objects are not supported
+	bool init();
+	bool isSupported() const { return supported; }
+
+	//copies the whole image to the texture
+	void upload(const Image& img);
+	//copies only some rectangles (corners inclusive, as min_x,min_y,max_x,max_y in rects) to the texture
+	//if the texture has another size the whole image is uploaded
+	void upload(const Image& img, const int* rects, unsigned int num_rects);
+
+	//draws the texture filling the viewport
+	void draw();
+
+private:
+	bool supported;
+	bool initialized;
+	GLuint texture;
+	GLuint buffer;
+	unsigned int width;		//size of the texture
+	unsigned int height;
+
+	void copyRect(const Image& img, int min_x, int min_y, int max_x, int max_y, Color* dest);
+};
+
+#endif
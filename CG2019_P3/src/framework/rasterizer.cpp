@@ -0,0 +1,84 @@
+#include "rasterizer.h"
+
+#include <algorithm>
+
+//floor(a / b) for b > 0, also for negative values of a
+static inline int floorDiv(int a, int b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+
+//top-left rule: an edge a->b of a counter-clockwise triangle owns the pixel centers that lie exactly on it
+//only if it is a left edge (going down) or a top edge (horizontal, going right) in framebuffer memory order
+static inline bool isTopLeft(int ax, int ay, int bx, int by)
+{
+	int dx = bx - ax;
+	int dy = by - ay;
+	return dy < 0 || (dy == 0 && dx > 0);
+}
+
+bool RasterTriangle::setup(const Vector2& v0, const Vector2& v1, const Vector2& v2, int clip_min_x, int clip_min_y, int clip_max_x, int clip_max_y, int margin)
+{
+	//reject what is far outside of the screen, the fixed point values would not fit
+	const float guard_min_x = clip_min_x - RASTER_GUARD_BAND, guard_max_x = clip_max_x + RASTER_GUARD_BAND;
+	const float guard_min_y = clip_min_y - RASTER_GUARD_BAND, guard_max_y = clip_max_y + RASTER_GUARD_BAND;
+	if (!(v0.x > guard_min_x && v0.x < guard_max_x && v0.y > guard_min_y && v0.y < guard_max_y &&
+		  v1.x > guard_min_x && v1.x < guard_max_x && v1.y > guard_min_y && v1.y < guard_max_y &&
+		  v2.x > guard_min_x && v2.x < guard_max_x && v2.y > guard_min_y && v2.y < guard_max_y))
+		return false;
+
+	//snap to the subpixel grid
+	int x0 = toFixed(v0.x), y0 = toFixed(v0.y);
+	int x1 = toFixed(v1.x), y1 = toFixed(v1.y);
+	int x2 = toFixed(v2.x), y2 = toFixed(v2.y);
+
+	long long area = static_cast<long long>(x1 - x0) * (y2 - y0) - static_cast<long long>(y1 - y0) * (x2 - x0);
+	if (area == 0)
+		return false;
+
+	//bounding box of the pixel centers that can be covered
+	int fx_min = std::min(x0, std::min(x1, x2)), fx_max = std::max(x0, std::max(x1, x2));
+	int fy_min = std::min(y0, std::min(y1, y2)), fy_max = std::max(y0, std::max(y1, y2));
+
+	min_x = std::max(clip_min_x, floorDiv(fx_min - SUBPIXEL_HALF + SUBPIXEL_ONE - 1, SUBPIXEL_ONE) - margin);
+	min_y = std::max(clip_min_y, floorDiv(fy_min - SUBPIXEL_HALF + SUBPIXEL_ONE - 1, SUBPIXEL_ONE) - margin);
+	max_x = std::min(clip_max_x, floorDiv(fx_max - SUBPIXEL_HALF, SUBPIXEL_ONE) + margin);
+	max_y = std::min(clip_max_y, floorDiv(fy_max - SUBPIXEL_HALF, SUBPIXEL_ONE) + margin);
+	if (min_x > max_x || min_y > max_y)
+		return false;
+
+	//clockwise triangles are handled as counter-clockwise ones with all the edges reversed
+	long long sign = area > 0 ? 1 : -1;
+	bool ccw = area > 0;
+
+	//edge a->b evaluated at p: (bx - ax) * (py - ay) - (by - ay) * (px - ax)
+	const int px = min_x * SUBPIXEL_ONE + SUBPIXEL_HALF;
+	const int py = min_y * SUBPIXEL_ONE + SUBPIXEL_HALF;
+
+	e0 = sign * (static_cast<long long>(x2 - x1) * (py - y1) - static_cast<long long>(y2 - y1) * (px - x1));
+	e1 = sign * (static_cast<long long>(x0 - x2) * (py - y2) - static_cast<long long>(y0 - y2) * (px - x2));
+	e2 = sign * (static_cast<long long>(x1 - x0) * (py - y0) - static_cast<long long>(y1 - y0) * (px - x0));
+
+	step_x0 = -sign * (y2 - y1) * SUBPIXEL_ONE; step_y0 = sign * (x2 - x1) * SUBPIXEL_ONE;
+	step_x1 = -sign * (y0 - y2) * SUBPIXEL_ONE; step_y1 = sign * (x0 - x2) * SUBPIXEL_ONE;
+	step_x2 = -sign * (y1 - y0) * SUBPIXEL_ONE; step_y2 = sign * (x1 - x0) * SUBPIXEL_ONE;
+
+	//pixels exactly on an edge which is not top-left are left to the neighbour triangle
+	if (!(ccw ? isTopLeft(x1, y1, x2, y2) : isTopLeft(x2, y2, x1, y1))) e0 -= 1;
+	if (!(ccw ? isTopLeft(x2, y2, x0, y0) : isTopLeft(x0, y0, x2, y2))) e1 -= 1;
+	if (!(ccw ? isTopLeft(x0, y0, x1, y1) : isTopLeft(x1, y1, x0, y0))) e2 -= 1;
+
+	inv_area = 1.f / static_cast<float>(area * sign);
+	return true;
+}
+
+void computeWeightSteps(const Vector3& v0, const Vector3& v1, const Vector3& v2, Vector3& dw_dx, Vector3& dw_dy)
+{
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (area == 0.f)
+	{
+		dw_dx.set(0, 0, 0);
+		dw_dy.set(0, 0, 0);
+		return;
+	}
+	float inv_area = 1.f / area;
+	dw_dx.set((v1.y - v2.y) * inv_area, (v2.y - v0.y) * inv_area, (v0.y - v1.y) * inv_area);
+	dw_dy.set((v2.x - v1.x) * inv_area, (v0.x - v2.x) * inv_area, (v1.x - v0.x) * inv_area);
+}
@@ -0,0 +1,98 @@
+/*  Fixed-point triangle rasterization core shared by the software renderers.
+	Vertices are snapped to a 28.4 grid (1/16 of pixel) and the coverage of every pixel center is
+	computed with integer edge functions, so the inner loops only do integer adds.
+	The top-left fill rule is used, so pixels on an edge shared by two triangles are drawn only once.
+*/
+
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include "framework.h"
+
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_ONE (1 << SUBPIXEL_BITS)
+#define SUBPIXEL_HALF (SUBPIXEL_ONE / 2)
+
+//vertices farther than this from the viewport (in pixels) are rejected, keeps the edge functions inside 64 bits
+#define RASTER_GUARD_BAND 65536.f
+
+//converts a pixel coordinate to 28.4 fixed point (rounding to the nearest subpixel)
+inline int toFixed(float v) { return static_cast<int>(std::floor(v * SUBPIXEL_ONE + 0.5f)); }
+
+//how much the barycentric weights of a screen space triangle change when moving one pixel in x or in y
+void computeWeightSteps(const Vector3& v0, const Vector3& v1, const Vector3& v2, Vector3& dw_dx, Vector3& dw_dy);
+
+class RasterTriangle
+{
+public:
+	//pixel bounding box of the triangle, inclusive and already clipped
+	int min_x, min_y;
+	int max_x, max_y;
+
+	//edge functions at the center of pixel (min_x, min_y), with the fill rule bias applied
+	//e0 is the edge opposite to v0 (v1->v2), e1 the one opposite to v1 (v2->v0) and e2 opposite to v2 (v0->v1)
+	long long e0, e1, e2;
+
+	//increments of every edge function when moving one pixel in x or in y
+	long long step_x0, step_x1, step_x2;
+	long long step_y0, step_y1, step_y2;
+
+	//1 / (2 * area) in subpixel units, turns an edge function into a barycentric weight
+	float inv_area;
+
+	//prepares the triangle for traversal, returns false if it has no area or it doesn't touch the clip rectangle
+	//margin grows the bounding box, needed when coverage is tested away from the pixel centers (multisampling)
+	bool setup(const Vector2& v0, const Vector2& v1, const Vector2& v2, int clip_min_x, int clip_min_y, int clip_max_x, int clip_max_y, int margin = 0);
+	bool setup(const Vector3& v0, const Vector3& v1, const Vector3& v2, unsigned int width, unsigned int height, int margin = 0)
+	{
+		return setup(Vector2(v0.x, v0.y), Vector2(v1.x, v1.y), Vector2(v2.x, v2.y), 0, 0, static_cast<int>(width) - 1, static_cast<int>(height) - 1, margin);
+	}
+
+	//how much the barycentric weights change when moving one pixel in x or in y
+	void getWeightSteps(Vector3& dw_dx, Vector3& dw_dy) const
+	{
+		dw_dx.set(step_x0 * inv_area, step_x1 * inv_area, step_x2 * inv_area);
+		dw_dy.set(step_y0 * inv_area, step_y1 * inv_area, step_y2 * inv_area);
+	}
+
+	//calls fragment(x, y, w0, w1, w2) for every covered pixel, w are the barycentric weights of v0, v1 and v2
+	template <typename F>
+	void traverse(F fragment) const { traverse(min_y, max_y, fragment); }
+
+	//same, but only for the rows between from_y and to_y (inclusive)
+	template <typename F>
+	void traverse(int from_y, int to_y, F fragment) const
+	{
+		if (from_y < min_y) from_y = min_y;
+		if (to_y > max_y) to_y = max_y;
+		if (from_y > to_y)
+			return;
+
+		long long skip = from_y - min_y;
+		long long row0 = e0 + step_y0 * skip;
+		long long row1 = e1 + step_y1 * skip;
+		long long row2 = e2 + step_y2 * skip;
+
+		for (int y = from_y; y <= to_y; ++y)
+		{
+			long long c0 = row0, c1 = row1, c2 = row2;
+			bool inside = false;
+			for (int x = min_x; x <= max_x; ++x)
+			{
+				if ((c0 | c1 | c2) >= 0)
+				{
+					inside = true;
+					fragment(x, y, c0 * inv_area, c1 * inv_area, c2 * inv_area);
+				}
+				else if (inside)
+					break; //triangles are convex, once we leave it there is nothing else in this row
+
+				c0 += step_x0; c1 += step_x1; c2 += step_x2;
+			}
+			row0 += step_y0; row1 += step_y1; row2 += step_y2;
+		}
+	}
+};
+
+
+#endif
@@ -0,0 +1,306 @@
+#include "resample.h"
+#include "allocator.h"
+#include "jobs.h"
+#include <cmath>
+
+//the weights are fixed point with this many bits, they add up to RESAMPLE_ONE
+#define RESAMPLE_BITS 14
+#define RESAMPLE_ONE (1 << RESAMPLE_BITS)
+//the rows between the two passes keep this many bits below the byte, in 16 bits with room for the overshoot of the
+//sharp filters, so they are rounded and clamped only once at the end
+#define RESAMPLE_EXTRA_BITS 6
+#define RESAMPLE_ROW_SHIFT (RESAMPLE_BITS - RESAMPLE_EXTRA_BITS)
+#define RESAMPLE_FINAL_SHIFT (RESAMPLE_BITS + RESAMPLE_EXTRA_BITS)
+//rows per job
+#define RESAMPLE_GRAIN 16
+
+//the rows of an image or a view, whatever the layout
+struct PixelRows
+{
+	Color* pixels;
+	unsigned int width;
+	unsigned int height;
+	unsigned int stride;	//only for LINEAR
+	unsigned int tiles_x;	//only for TILED
+	PixelLayout layout;
+};
+
+static PixelRows getRows(const ImageView& view)
+{
+	PixelRows rows = { view.pixels, view.width, view.height, view.stride, 0, LINEAR };
+	return rows;
+}
+
+static PixelRows getRows(const Image& img)
+{
+	PixelRows rows = { img.pixels, img.width, img.height, img.width, img.tiles_x, img.layout };
+	return rows;
+}
+
+//the first width pixels of the row y, scratch is used when they are not together in memory
+static const Color* readRow(const PixelRows& img, unsigned int y, unsigned int width, Color* scratch)
+{
+	if (img.layout == LINEAR)
+		return img.pixels + y * img.stride;
+
+	const Color* tile_row = img.pixels + (((y >> PIXEL_TILE_BITS) * img.tiles_x) << (2 * PIXEL_TILE_BITS)) + ((y & PIXEL_TILE_MASK) << PIXEL_TILE_BITS);
+	for (unsigned int x = 0; x < width; x += PIXEL_TILE_SIZE)
+	{
+		unsigned int count = width - x < PIXEL_TILE_SIZE ? width - x : PIXEL_TILE_SIZE;
+		memcpy(scratch + x, tile_row + ((x >> PIXEL_TILE_BITS) << (2 * PIXEL_TILE_BITS)), count * sizeof(Color));
+	}
+	return scratch;
+}
+
+//where to write the row y, writeRow must be called after filling it
+static Color* getRowForWriting(const PixelRows& img, unsigned int y, Color* scratch)
+{
+	return img.layout == LINEAR ? img.pixels + y * img.stride : scratch;
+}
+
+static void writeRow(const PixelRows& img, unsigned int y, const Color* row)
+{
+	if (img.layout == LINEAR)
+		return;
+
+	Color* tile_row = img.pixels + (((y >> PIXEL_TILE_BITS) * img.tiles_x) << (2 * PIXEL_TILE_BITS)) + ((y & PIXEL_TILE_MASK) << PIXEL_TILE_BITS);
+	for (unsigned int x = 0; x < img.width; x += PIXEL_TILE_SIZE)
+	{
+		unsigned int count = img.width - x < PIXEL_TILE_SIZE ? img.width - x : PIXEL_TILE_SIZE;
+		memcpy(tile_row + ((x >> PIXEL_TILE_BITS) << (2 * PIXEL_TILE_BITS)), row + x, count * sizeof(Color));
+	}
+}
+
+static float filterSupport(ResampleFilter filter)
+{
+	switch (filter)
+	{
+		case RESAMPLE_BILINEAR: return 1.0f;
+		case RESAMPLE_BICUBIC: return 2.0f;
+		case RESAMPLE_LANCZOS: return 3.0f;
+		default: return 0.5f;
+	}
+}
+
+static float filterWeight(ResampleFilter filter, float x)
+{
+	x = fabsf(x);
+	switch (filter)
+	{
+		case RESAMPLE_BILINEAR:
+			return x < 1.0f ? 1.0f - x : 0.0f;
+		case RESAMPLE_BICUBIC:
+			//Catmull-Rom (a = -0.5)
+			if (x < 1.0f)
+				return (1.5f * x - 2.5f) * x * x + 1.0f;
+			if (x < 2.0f)
+				return ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f;
+			return 0.0f;
+		case RESAMPLE_LANCZOS:
+			if (x < 1e-5f)
+				return 1.0f;
+			if (x < 3.0f)
+				return 3.0f * sinf((float)PI * x) * sinf((float)PI * x / 3.0f) / ((float)(PI * PI) * x * x);
+			return 0.0f;
+		default:
+			return 1.0f;
+	}
+}
+
+//for every destination pixel, the first source pixel that contributes to it, how many do and their weights (taps per pixel)
+struct ResampleTable
+{
+	int* first;
+	int* count;
+	int* weights;
+	int taps;
+};
+
+//src_size is scaled to scaled_size, only the first dst_size pixels of the result are needed
+static void computeTable(ResampleFilter filter, unsigned int src_size, unsigned int scaled_size, unsigned int dst_size, Arena& arena, ResampleTable& table)
+{
+	float ratio = src_size / (float)scaled_size;
+	float filter_scale = ratio > 1.0f ? ratio : 1.0f; //shrinking, the filter covers all the pixels that go to one
+	float radius = filterSupport(filter) * filter_scale;
+
+	table.taps = filter == RESAMPLE_NEAREST ? 1 : (int)ceilf(radius) * 2 + 1;
+	if (table.taps > (int)src_size)
+		table.taps = src_size;
+	table.first = arena.allocateArray<int>(dst_size);
+	table.count = arena.allocateArray<int>(dst_size);
+	table.weights = arena.allocateArray<int>(dst_size * table.taps);
+	float* weights = arena.allocateArray<float>(table.taps);
+
+	for (unsigned int i = 0; i < dst_size; ++i)
+	{
+		int* fixed = table.weights + i * table.taps;
+		if (filter == RESAMPLE_NEAREST)
+		{
+			table.first[i] = (int)((unsigned long long)i * src_size / scaled_size);
+			table.count[i] = 1;
+			fixed[0] = RESAMPLE_ONE;
+			continue;
+		}
+
+		//position of the center of the pixel in the source
+		float center = (i + 0.5f) * ratio - 0.5f;
+		int first = (int)ceilf(center - radius);
+		int last = (int)floorf(center + radius);
+		if (first < 0) first = 0;
+		if (last > (int)src_size - 1) last = src_size - 1;
+		if (last - first + 1 > table.taps) last = first + table.taps - 1;
+
+		float total = 0;
+		for (int j = first; j <= last; ++j)
+		{
+			weights[j - first] = filterWeight(filter, (j - center) / filter_scale);
+			total += weights[j - first];
+		}
+		if (total <= 0)
+		{
+			//nothing around (only at the borders of tiny images), the closest pixel is used
+			first = (int)floorf(center + 0.5f);
+			first = last = first < 0 ? 0 : (first > (int)src_size - 1 ? src_size - 1 : first);
+			weights[0] = total = 1;
+		}
+
+		//rounding the weights loses some bits, what is missing goes to the biggest so they add up to one
+		int sum = 0, biggest = 0;
+		for (int j = 0; j <= last - first; ++j)
+		{
+			fixed[j] = (int)floorf(weights[j] / total * RESAMPLE_ONE + 0.5f);
+			sum += fixed[j];
+			if (fixed[j] > fixed[biggest])
+				biggest = j;
+		}
+		fixed[biggest] += RESAMPLE_ONE - sum;
+		table.first[i] = first;
+		table.count[i] = last - first + 1;
+	}
+}
+
+//result of the horizontal pass, not clamped
+static inline short toRowValue(int value)
+{
+	return (short)((value + (1 << (RESAMPLE_ROW_SHIFT - 1))) >> RESAMPLE_ROW_SHIFT);
+}
+
+//result of the vertical pass
+static inline unsigned char toByte(int value)
+{
+	value = (value + (1 << (RESAMPLE_FINAL_SHIFT - 1))) >> RESAMPLE_FINAL_SHIFT;
+	return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+static void resampleRows(const PixelRows& src, unsigned int width, unsigned int height, PixelRows dst, ResampleFilter filter)
+{
+	//dst can't be bigger than the scaled image
+	if (dst.width > width) dst.width = width;
+	if (dst.height > height) dst.height = height;
+	if (!src.width || !src.height || !dst.width || !dst.height)
+		return;
+
+	Arena& arena = Arena::getFrame();
+	ArenaScope scope(arena);
+	ResampleTable table_x, table_y;
+	computeTable(filter, src.width, width, dst.width, arena, table_x);
+	computeTable(filter, src.height, height, dst.height, arena, table_y);
+
+	if (filter == RESAMPLE_NEAREST)
+	{
+		//no filtering, every pixel is taken from its row
+		bool same_columns = width == src.width;
+		JobSystem::get().parallelFor(0, dst.height, RESAMPLE_GRAIN, [&](int from, int to) {
+			Arena& job_arena = Arena::getFrame();
+			ArenaScope job_scope(job_arena);
+			Color* src_scratch = job_arena.allocateArray<Color>(src.width);
+			Color* dst_scratch = job_arena.allocateArray<Color>(dst.width);
+			for (int y = from; y < to; ++y)
+			{
+				const Color* src_row = readRow(src, table_y.first[y], src.width, src_scratch);
+				Color* dst_row = getRowForWriting(dst, y, dst_scratch);
+				if (same_columns)
+					memcpy(dst_row, src_row, dst.width * sizeof(Color));
+				else
+					for (unsigned int x = 0; x < dst.width; ++x)
+						dst_row[x] = src_row[table_x.first[x]];
+				writeRow(dst, y, dst_row);
+			}
+		});
+		return;
+	}
+
+	//only the source rows used by the destination are scaled horizontally
+	int row_begin = table_y.first[0];
+	int row_end = table_y.first[dst.height - 1] + table_y.count[dst.height - 1];
+	for (unsigned int y = 0; y < dst.height; ++y)
+	{
+		if (table_y.first[y] < row_begin) row_begin = table_y.first[y];
+		if (table_y.first[y] + table_y.count[y] > row_end) row_end = table_y.first[y] + table_y.count[y];
+	}
+	const unsigned int channels = dst.width * 3;
+	short* rows = arena.allocateArray<short>((size_t)(row_end - row_begin) * channels);
+
+	//horizontal pass, from the source rows to rows of the destination width
+	JobSystem::get().parallelFor(row_begin, row_end, RESAMPLE_GRAIN, [&](int from, int to) {
+		Arena& job_arena = Arena::getFrame();
+		ArenaScope job_scope(job_arena);
+		Color* scratch = job_arena.allocateArray<Color>(src.width);
+		for (int y = from; y < to; ++y)
+		{
+			const Color* src_row = readRow(src, y, src.width, scratch);
+			short* row = rows + (size_t)(y - row_begin) * channels;
+			for (unsigned int x = 0; x < dst.width; ++x)
+			{
+				const Color* pixel = src_row + table_x.first[x];
+				const int* weights = table_x.weights + x * table_x.taps;
+				int r = 0, g = 0, b = 0;
+				for (int k = 0; k < table_x.count[x]; ++k)
+				{
+					r += pixel[k].r * weights[k];
+					g += pixel[k].g * weights[k];
+					b += pixel[k].b * weights[k];
+				}
+				row[x * 3] = toRowValue(r);
+				row[x * 3 + 1] = toRowValue(g);
+				row[x * 3 + 2] = toRowValue(b);
+			}
+		}
+	});
+
+	//vertical pass, every destination row is a weighted sum of whole rows, channel after channel
+	JobSystem::get().parallelFor(0, dst.height, RESAMPLE_GRAIN, [&](int from, int to) {
+		Arena& job_arena = Arena::getFrame();
+		ArenaScope job_scope(job_arena);
+		int* sums = job_arena.allocateArray<int>(channels);
+		Color* scratch = job_arena.allocateArray<Color>(dst.width);
+		for (int y = from; y < to; ++y)
+		{
+			memset(sums, 0, channels * sizeof(int));
+			const int* weights = table_y.weights + y * table_y.taps;
+			for (int k = 0; k < table_y.count[y]; ++k)
+			{
+				const short* row = rows + (size_t)(table_y.first[y] + k - row_begin) * channels;
+				int weight = weights[k];
+				for (unsigned int i = 0; i < channels; ++i)
+					sums[i] += row[i] * weight;
+			}
+
+			Color* dst_row = getRowForWriting(dst, y, scratch);
+			unsigned char* bytes = (unsigned char*)dst_row;
+			for (unsigned int i = 0; i < channels; ++i)
+				bytes[i] = toByte(sums[i]);
+			writeRow(dst, y, dst_row);
+		}
+	});
+}
+
+void resample(const ImageView& src, unsigned int width, unsigned int height, const ImageView& dst, ResampleFilter filter)
+{
+	resampleRows(getRows(src), width, height, getRows(dst), filter);
+}
+
+void resample(const Image& src, Image& dst, ResampleFilter filter)
+{
+	resampleRows(getRows(src), dst.width, dst.height, getRows(dst), filter);
+}
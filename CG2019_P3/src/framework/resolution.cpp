@@ -0,0 +1,72 @@
+#include "resolution.h"
+#include <cmath>
+
+//the scale changes in steps of 1/RESOLUTION_STEPS, so the buffers are not resized every frame
+#define RESOLUTION_STEPS 16
+//weight of the last frame in the averaged cost
+#define RESOLUTION_SMOOTHING 0.25f
+//to grow the frames must fit in this fraction of the budget, so it doesn't go up and down all the time
+#define RESOLUTION_HEADROOM 0.85f
+
+static float quantizeScale(float scale, float min_scale)
+{
+	scale = floorf(scale * RESOLUTION_STEPS) / RESOLUTION_STEPS;
+	return clamp(scale, min_scale, 1.0f);
+}
+
+ResolutionScaler::ResolutionScaler(float budget, float min_scale)
+{
+	this->budget = budget;
+	this->min_scale = min_scale;
+	reset();
+}
+
+void ResolutionScaler::reset()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	full_cost = 0;
+	scale = 1;
+	measured = false;
+}
+
+void ResolutionScaler::addSample(float time, float scale)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	//the fill cost is proportional to the pixels, so this is what the frame would have taken at full resolution
+	float cost = time / (scale * scale);
+	if (!measured)
+		full_cost = cost;
+	else
+		full_cost += (cost - full_cost) * RESOLUTION_SMOOTHING;
+	measured = true;
+	if (full_cost <= 0)
+	{
+		this->scale = 1;
+		return;
+	}
+
+	//shrink as soon as the budget is exceeded, grow only when there is some time to spare
+	float fit = sqrtf(budget / full_cost);
+	float fit_with_headroom = sqrtf(budget * RESOLUTION_HEADROOM / full_cost);
+	if (fit < this->scale)
+		this->scale = quantizeScale(fit, min_scale);
+	else if (quantizeScale(fit_with_headroom, min_scale) > this->scale)
+		this->scale = quantizeScale(fit_with_headroom, min_scale);
+}
+
+float ResolutionScaler::getScale()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return scale;
+}
+
+void getScaledSize(unsigned int width, unsigned int height, float scale, unsigned int& scaled_width, unsigned int& scaled_height)
+{
+	scaled_width = (unsigned int)(width * scale + 0.5f);
+	scaled_height = (unsigned int)(height * scale + 0.5f);
+	if (scaled_width < 1)
+		scaled_width = 1;
+	if (scaled_height < 1)
+		scaled_height = 1;
+}
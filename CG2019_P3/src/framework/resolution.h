@@ -0,0 +1,38 @@
+/*  Dynamic resolution.
+	The cost of filling the triangles grows with the pixels they cover, so when a frame is too slow the next ones are
+	rendered in a smaller image and scaled up to the window. The scale is chosen from the measured render times so the
+	frames take about the time of the budget.
+*/
+
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+#include <mutex>
+#include "image.h"
+
+class ResolutionScaler
+{
+public:
+	float budget;		//time wanted per frame (in ms)
+	float min_scale;	//the image is never smaller than this fraction of the window (in each axis)
+
+	ResolutionScaler(float budget = 1000.0f / 60.0f, float min_scale = 0.25f);
+
+	//the time a frame took to render (in ms) and the scale it used, can be called from the render thread
+	void addSample(float time, float scale);
+	//the scale for the next frame (from min_scale to 1)
+	float getScale();
+	//forgets the measures and goes back to the full resolution
+	void reset();
+
+private:
+	std::mutex mutex;
+	float full_cost;	//estimated time to render at full resolution, averaged along the last frames
+	float scale;
+	bool measured;
+};
+
+//the size of the image rendered with the given scale, at least 1x1
+void getScaledSize(unsigned int width, unsigned int height, float scale, unsigned int& scaled_width, unsigned int& scaled_height);
+
+#endif
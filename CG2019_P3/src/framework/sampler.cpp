@@ -0,0 +1,166 @@
+#include "sampler.h"
+#include "image.h"
+
+#include <algorithm>
+
+Sampler::Sampler()
+{
+	filter = TRILINEAR;
+	wrap = REPEAT;
+}
+
+Sampler::Sampler(const Image& image, Filter filter, Wrap wrap)
+{
+	this->filter = filter;
+	this->wrap = wrap;
+	load(image);
+}
+
+void Sampler::clear()
+{
+	levels.clear();
+}
+
+//allocates a level rounding the size up to whole tiles
+static void allocLevel(std::vector<Color>& texels, unsigned int& tiles_x, unsigned int width, unsigned int height)
+{
+	tiles_x = (width + 3) >> 2;
+	unsigned int tiles_y = (height + 3) >> 2;
+	texels.resize(tiles_x * tiles_y * 16);
+}
+
+void Sampler::load(const Image& image)
+{
+	levels.clear();
+	if (!image.pixels || !image.width || !image.height)
+		return;
+
+	//first level is a tiled copy of the image
+	levels.push_back(Level());
+	Level& base = levels.back();
+	base.width = image.width;
+	base.height = image.height;
+	allocLevel(base.texels, base.tiles_x, base.width, base.height);
+	for (unsigned int y = 0; y < image.height; ++y)
+		for (unsigned int x = 0; x < image.width; ++x)
+			base.texel(x, y) = image.getPixel(x, y);
+
+	//every next level is the average of 2x2 texels of the previous one, until it is 1x1
+	while (levels.back().width > 1 || levels.back().height > 1)
+	{
+		levels.push_back(Level());
+		const Level& src = levels[levels.size() - 2];
+		Level& dst = levels.back();
+		dst.width = src.width > 1 ? src.width >> 1 : 1;
+		dst.height = src.height > 1 ? src.height >> 1 : 1;
+		allocLevel(dst.texels, dst.tiles_x, dst.width, dst.height);
+
+		for (unsigned int y = 0; y < dst.height; ++y)
+		{
+			unsigned int y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+			for (unsigned int x = 0; x < dst.width; ++x)
+			{
+				unsigned int x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+				const Color& a = src.texel(x0, y0);
+				const Color& b = src.texel(x1, y0);
+				const Color& c = src.texel(x0, y1);
+				const Color& d = src.texel(x1, y1);
+				Color& r = dst.texel(x, y);
+				r.r = (a.r + b.r + c.r + d.r + 2) >> 2;
+				r.g = (a.g + b.g + c.g + d.g + 2) >> 2;
+				r.b = (a.b + b.b + c.b + d.b + 2) >> 2;
+			}
+		}
+	}
+}
+
+float Sampler::computeLod(float du_dx, float dv_dx, float du_dy, float dv_dy) const
+{
+	if (levels.empty())
+		return 0.f;
+
+	//footprint of one pixel in texels of the first level
+	float w = static_cast<float>(levels[0].width);
+	float h = static_cast<float>(levels[0].height);
+	float len_x = du_dx * du_dx * w * w + dv_dx * dv_dx * h * h;
+	float len_y = du_dy * du_dy * w * w + dv_dy * dv_dy * h * h;
+	float len = std::max(len_x, len_y);
+	if (len <= 1.f)
+		return 0.f;
+	return 0.5f * std::log2(len);
+}
+
+inline void Sampler::wrapCoord(int& c, unsigned int size) const
+{
+	int s = static_cast<int>(size);
+	if (wrap == REPEAT)
+	{
+		c %= s;
+		if (c < 0) c += s;
+	}
+	else
+		c = c < 0 ? 0 : (c >= s ? s - 1 : c);
+}
+
+Color Sampler::sampleLevel(const Level& level, float u, float v) const
+{
+	if (filter == NEAREST)
+	{
+		int x = static_cast<int>(std::floor(u * level.width));
+		int y = static_cast<int>(std::floor(v * level.height));
+		wrapCoord(x, level.width);
+		wrapCoord(y, level.height);
+		return level.texel(x, y);
+	}
+
+	//bilinear, texel centers are at half integer coordinates, weights in 8 bits fixed point
+	float fx = u * level.width - 0.5f;
+	float fy = v * level.height - 0.5f;
+	float flx = std::floor(fx), fly = std::floor(fy);
+	int x0 = static_cast<int>(flx), y0 = static_cast<int>(fly);
+	int wx = static_cast<int>((fx - flx) * 256.f);
+	int wy = static_cast<int>((fy - fly) * 256.f);
+	int x1 = x0 + 1, y1 = y0 + 1;
+	wrapCoord(x0, level.width); wrapCoord(x1, level.width);
+	wrapCoord(y0, level.height); wrapCoord(y1, level.height);
+
+	const Color& a = level.texel(x0, y0);
+	const Color& b = level.texel(x1, y0);
+	const Color& c = level.texel(x0, y1);
+	const Color& d = level.texel(x1, y1);
+
+	Color r;
+	for (int i = 0; i < 3; ++i)
+	{
+		int top = a.v[i] * (256 - wx) + b.v[i] * wx;
+		int bottom = c.v[i] * (256 - wx) + d.v[i] * wx;
+		r.v[i] = static_cast<unsigned char>((top * (256 - wy) + bottom * wy) >> 16);
+	}
+	return r;
+}
+
+Color Sampler::sample(float u, float v, float lod) const
+{
+	if (levels.empty())
+		return Color::BLACK;
+
+	unsigned int last = static_cast<unsigned int>(levels.size()) - 1;
+	if (lod <= 0.f || filter != TRILINEAR)
+	{
+		//nearest and bilinear pick the closest level
+		unsigned int level = lod <= 0.f ? 0 : std::min(static_cast<unsigned int>(lod + 0.5f), last);
+		return sampleLevel(levels[level], u, v);
+	}
+
+	unsigned int level = std::min(static_cast<unsigned int>(lod), last);
+	if (level == last)
+		return sampleLevel(levels[last], u, v);
+
+	int w = static_cast<int>((lod - level) * 256.f);
+	Color a = sampleLevel(levels[level], u, v);
+	Color b = sampleLevel(levels[level + 1], u, v);
+	Color r;
+	for (int i = 0; i < 3; ++i)
+		r.v[i] = static_cast<unsigned char>((a.v[i] * (256 - w) + b.v[i] * w) >> 8);
+	return r;
+}
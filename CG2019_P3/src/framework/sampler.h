@@ -0,0 +1,60 @@
+/*  Texture sampler for the software rasterizer.
+	It keeps a copy of an Image with all its mipmaps, stored in 4x4 tiles so the texels fetched for one
+	bilinear lookup (and for the neighbour pixels) are usually in the same cache line.
+	Supports nearest, bilinear and trilinear filtering with repeat or clamp wrapping.
+*/
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <vector>
+#include "framework.h"
+
+class Image;
+
+class Sampler
+{
+	//one level of the mip chain, texels are stored tile after tile (4x4 texels per tile)
+	struct Level
+	{
+		unsigned int width;
+		unsigned int height;
+		unsigned int tiles_x; //tiles per row
+		std::vector<Color> texels;
+
+		const Color& texel(unsigned int x, unsigned int y) const { return texels[(((y >> 2) * tiles_x + (x >> 2)) << 4) + ((y & 3) << 2) + (x & 3)]; }
+		Color& texel(unsigned int x, unsigned int y) { return texels[(((y >> 2) * tiles_x + (x >> 2)) << 4) + ((y & 3) << 2) + (x & 3)]; }
+	};
+
+public:
+	enum Filter { NEAREST, BILINEAR, TRILINEAR };
+	enum Wrap { REPEAT, CLAMP };
+
+	Filter filter;
+	Wrap wrap;
+
+	Sampler();
+	Sampler(const Image& image, Filter filter = TRILINEAR, Wrap wrap = REPEAT);
+
+	//copies the image and builds the whole mip chain
+	void load(const Image& image);
+	void clear();
+
+	unsigned int getWidth() const { return levels.empty() ? 0 : levels[0].width; }
+	unsigned int getHeight() const { return levels.empty() ? 0 : levels[0].height; }
+	unsigned int getNumLevels() const { return static_cast<unsigned int>(levels.size()); }
+
+	//level of detail given the derivatives of the texture coordinates (in 0..1 units) along the screen axes
+	float computeLod(float du_dx, float dv_dx, float du_dy, float dv_dy) const;
+
+	//u,v in 0..1, lod 0 is the full resolution image
+	Color sample(float u, float v, float lod = 0.f) const;
+
+private:
+	std::vector<Level> levels;
+
+	Color sampleLevel(const Level& level, float u, float v) const;
+	void wrapCoord(int& c, unsigned int size) const;
+};
+
+#endif
@@ -0,0 +1,245 @@
+#include "transform.h"
+#include "jobs.h"
+
+//streams with more vertices than this are split between the threads of the job system, in pieces of TRANSFORM_GRAIN
+#define TRANSFORM_PARALLEL_MIN 16384
+#define TRANSFORM_GRAIN 4096 //multiple of 4, so only the last piece has a tail without SSE
+
+void VertexStream::resize(unsigned int size)
+{
+	x.resize(size);
+	y.resize(size);
+	z.resize(size);
+	w.resize(size);
+}
+
+void VertexStream::load(const Vector3* points, unsigned int count)
+{
+	resize(count);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		x[i] = points[i].x;
+		y[i] = points[i].y;
+		z[i] = points[i].z;
+		w[i] = 1.0f;
+	}
+}
+
+//the two kinds of input, both give one vertex or (with SSE) four vertices with the components in separated registers
+struct ArrayInput
+{
+	const Vector3* points;
+	Vector3 get(unsigned int i) const { return points[i]; }
+#ifdef FRAMEWORK_SSE
+	//the 4 vertices are 12 floats in a row: 3 loads and shuffles to transpose them
+	void get4(unsigned int i, __m128& x, __m128& y, __m128& z) const
+	{
+		const float* p = points[i].v;
+		__m128 a = _mm_loadu_ps(p);		//x0 y0 z0 x1
+		__m128 b = _mm_loadu_ps(p + 4);	//y1 z1 x2 y2
+		__m128 c = _mm_loadu_ps(p + 8);	//z2 x3 y3 z3
+		x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+		y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+		z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+	}
+#endif
+};
+
+struct StreamInput
+{
+	const float* x;
+	const float* y;
+	const float* z;
+	Vector3 get(unsigned int i) const { return Vector3(x[i], y[i], z[i]); }
+#ifdef FRAMEWORK_SSE
+	void get4(unsigned int i, __m128& vx, __m128& vy, __m128& vz) const
+	{
+		vx = _mm_loadu_ps(x + i);
+		vy = _mm_loadu_ps(y + i);
+		vz = _mm_loadu_ps(z + i);
+	}
+#endif
+};
+
+static ArrayInput makeInput(const Vector3* points) { ArrayInput input = { points }; return input; }
+static StreamInput makeInput(const VertexStream& stream)
+{
+	StreamInput input = { stream.x.data(), stream.y.data(), stream.z.data() };
+	return input;
+}
+
+//resizes out and calls process(from, to) for the whole range, in parallel if it is big
+template <typename F>
+static void forEachBatch(unsigned int count, VertexStream& out, F process)
+{
+	out.resize(count);
+	if (count < TRANSFORM_PARALLEL_MIN)
+		process(0, count);
+	else
+		JobSystem::get().parallelFor(0, count, TRANSFORM_GRAIN, [&](int from, int to) { process(from, to); });
+}
+
+//with SSE the vertices go four by four and the remaining ones (or all of them without SSE) one by one
+template <typename Input>
+static void _transformPositions(const Matrix44& matrix, Input input, unsigned int from, unsigned int to, VertexStream& out)
+{
+	const float* m = matrix.m;
+	unsigned int i = from;
+
+#ifdef FRAMEWORK_SSE
+	__m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]), m3 = _mm_set1_ps(m[3]);
+	__m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]);
+	__m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]), m11 = _mm_set1_ps(m[11]);
+	__m128 m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]), m15 = _mm_set1_ps(m[15]);
+	for (; i + 4 <= to; i += 4)
+	{
+		__m128 x, y, z;
+		input.get4(i, x, y, z);
+		_mm_storeu_ps(&out.x[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m0), _mm_mul_ps(y, m4)), _mm_add_ps(_mm_mul_ps(z, m8), m12)));
+		_mm_storeu_ps(&out.y[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m1), _mm_mul_ps(y, m5)), _mm_add_ps(_mm_mul_ps(z, m9), m13)));
+		_mm_storeu_ps(&out.z[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m2), _mm_mul_ps(y, m6)), _mm_add_ps(_mm_mul_ps(z, m10), m14)));
+		_mm_storeu_ps(&out.w[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m3), _mm_mul_ps(y, m7)), _mm_add_ps(_mm_mul_ps(z, m11), m15)));
+	}
+#endif
+
+	for (; i < to; ++i)
+	{
+		Vector3 p = input.get(i);
+		out.x[i] = p.x * m[0] + p.y * m[4] + p.z * m[8] + m[12];
+		out.y[i] = p.x * m[1] + p.y * m[5] + p.z * m[9] + m[13];
+		out.z[i] = p.x * m[2] + p.y * m[6] + p.z * m[10] + m[14];
+		out.w[i] = p.x * m[3] + p.y * m[7] + p.z * m[11] + m[15];
+	}
+}
+
+//inverse transpose of the rotation and scale part
+static Matrix44 getNormalMatrix(const Matrix44& model)
+{
+	Matrix44 matrix = model;
+	matrix.m[3] = matrix.m[7] = matrix.m[11] = 0.0f;
+	matrix.m[12] = matrix.m[13] = matrix.m[14] = 0.0f;
+	matrix.m[15] = 1.0f;
+	matrix.inverse();
+	matrix.transpose();
+	return matrix;
+}
+
+template <typename Input>
+static void _transformNormals(const Matrix44& matrix, Input input, unsigned int from, unsigned int to, VertexStream& out)
+{
+	const float* m = matrix.m;
+	unsigned int i = from;
+
+#ifdef FRAMEWORK_SSE
+	__m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+	__m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+	__m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+	__m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+	for (; i + 4 <= to; i += 4)
+	{
+		__m128 x, y, z;
+		input.get4(i, x, y, z);
+		__m128 nx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m0), _mm_mul_ps(y, m4)), _mm_mul_ps(z, m8));
+		__m128 ny = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m1), _mm_mul_ps(y, m5)), _mm_mul_ps(z, m9));
+		__m128 nz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m2), _mm_mul_ps(y, m6)), _mm_mul_ps(z, m10));
+
+		//zero length normals are left as they are
+		__m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+		__m128 valid = _mm_cmpgt_ps(len2, zero);
+		__m128 inv_len = _mm_div_ps(one, _mm_sqrt_ps(_mm_or_ps(_mm_and_ps(valid, len2), _mm_andnot_ps(valid, one))));
+		_mm_storeu_ps(&out.x[i], _mm_mul_ps(nx, inv_len));
+		_mm_storeu_ps(&out.y[i], _mm_mul_ps(ny, inv_len));
+		_mm_storeu_ps(&out.z[i], _mm_mul_ps(nz, inv_len));
+		_mm_storeu_ps(&out.w[i], zero);
+	}
+#endif
+
+	for (; i < to; ++i)
+	{
+		Vector3 n = input.get(i);
+		Vector3 r(	n.x * m[0] + n.y * m[4] + n.z * m[8],
+					n.x * m[1] + n.y * m[5] + n.z * m[9],
+					n.x * m[2] + n.y * m[6] + n.z * m[10] );
+		r.normalize();
+		out.x[i] = r.x;
+		out.y[i] = r.y;
+		out.z[i] = r.z;
+		out.w[i] = 0.0f;
+	}
+}
+
+template <typename Input>
+static void _projectPositions(const Matrix44& viewprojection, Input input, unsigned int from, unsigned int to, float width, float height, VertexStream& out)
+{
+	const float* m = viewprojection.m;
+	const float half_width = width * 0.5f;
+	const float half_height = height * 0.5f;
+	unsigned int i = from;
+
+#ifdef FRAMEWORK_SSE
+	__m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]), m3 = _mm_set1_ps(m[3]);
+	__m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]);
+	__m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]), m11 = _mm_set1_ps(m[11]);
+	__m128 m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]), m15 = _mm_set1_ps(m[15]);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 hw = _mm_set1_ps(half_width), hh = _mm_set1_ps(half_height);
+	for (; i + 4 <= to; i += 4)
+	{
+		__m128 x, y, z;
+		input.get4(i, x, y, z);
+		__m128 cx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m0), _mm_mul_ps(y, m4)), _mm_add_ps(_mm_mul_ps(z, m8), m12));
+		__m128 cy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m1), _mm_mul_ps(y, m5)), _mm_add_ps(_mm_mul_ps(z, m9), m13));
+		__m128 cz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m2), _mm_mul_ps(y, m6)), _mm_add_ps(_mm_mul_ps(z, m10), m14));
+		__m128 cw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m3), _mm_mul_ps(y, m7)), _mm_add_ps(_mm_mul_ps(z, m11), m15));
+
+		//(ndc + 1) * half_size = ndc * half_size + half_size
+		__m128 inv_w = _mm_div_ps(one, cw);
+		_mm_storeu_ps(&out.x[i], _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cx, inv_w), hw), hw));
+		_mm_storeu_ps(&out.y[i], _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cy, inv_w), hh), hh));
+		_mm_storeu_ps(&out.z[i], _mm_mul_ps(cz, inv_w));
+		_mm_storeu_ps(&out.w[i], inv_w);
+	}
+#endif
+
+	for (; i < to; ++i)
+	{
+		Vector3 p = input.get(i);
+		float inv_w = 1.0f / (p.x * m[3] + p.y * m[7] + p.z * m[11] + m[15]);
+		out.x[i] = ((p.x * m[0] + p.y * m[4] + p.z * m[8] + m[12]) * inv_w + 1.0f) * half_width;
+		out.y[i] = ((p.x * m[1] + p.y * m[5] + p.z * m[9] + m[13]) * inv_w + 1.0f) * half_height;
+		out.z[i] = (p.x * m[2] + p.y * m[6] + p.z * m[10] + m[14]) * inv_w;
+		out.w[i] = inv_w;
+	}
+}
+
+void transformPositions(const Matrix44& matrix, const Vector3* points, unsigned int count, VertexStream& out)
+{
+	forEachBatch(count, out, [&](unsigned int from, unsigned int to) { _transformPositions(matrix, makeInput(points), from, to, out); });
+}
+
+void transformPositions(const Matrix44& matrix, const VertexStream& points, VertexStream& out)
+{
+	forEachBatch(points.size(), out, [&](unsigned int from, unsigned int to) { _transformPositions(matrix, makeInput(points), from, to, out); });
+}
+
+void transformNormals(const Matrix44& model, const Vector3* normals, unsigned int count, VertexStream& out)
+{
+	Matrix44 matrix = getNormalMatrix(model);
+	forEachBatch(count, out, [&](unsigned int from, unsigned int to) { _transformNormals(matrix, makeInput(normals), from, to, out); });
+}
+
+void transformNormals(const Matrix44& model, const VertexStream& normals, VertexStream& out)
+{
+	Matrix44 matrix = getNormalMatrix(model);
+	forEachBatch(normals.size(), out, [&](unsigned int from, unsigned int to) { _transformNormals(matrix, makeInput(normals), from, to, out); });
+}
+
+void projectPositions(const Matrix44& viewprojection, const Vector3* points, unsigned int count, float width, float height, VertexStream& out)
+{
+	forEachBatch(count, out, [&](unsigned int from, unsigned int to) { _projectPositions(viewprojection, makeInput(points), from, to, width, height, out); });
+}
+
+void projectPositions(const Matrix44& viewprojection, const VertexStream& points, float width, float height, VertexStream& out)
+{
+	forEachBatch(points.size(), out, [&](unsigned int from, unsigned int to) { _projectPositions(viewprojection, makeInput(points), from, to, width, height, out); });
+}
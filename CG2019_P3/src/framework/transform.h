@@ -0,0 +1,46 @@
+/*  Bulk transforms of vertex streams.
+	The results are stored as a structure of arrays (all the x, then all the y, ...) so the SIMD code handles
+	four vertices per instruction. The input can be an array of Vector3 (like Mesh::vertices) or another stream.
+*/
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <vector>
+#include "framework.h"
+
+class VertexStream
+{
+public:
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> w;
+
+	VertexStream() {}
+	VertexStream(const Vector3* points, unsigned int count) { load(points, count); }
+
+	unsigned int size() const { return static_cast<unsigned int>(x.size()); }
+	void resize(unsigned int size);
+
+	//copies the points into the stream, with w = 1
+	void load(const Vector3* points, unsigned int count);
+
+	Vector3 getVector3(unsigned int i) const { return Vector3(x[i], y[i], z[i]); }
+	Vector4 getVector4(unsigned int i) const { return Vector4(x[i], y[i], z[i], w[i]); }
+};
+
+//out = matrix * (point, 1), the result in clip space when the matrix is a viewprojection (w is kept)
+void transformPositions(const Matrix44& matrix, const Vector3* points, unsigned int count, VertexStream& out);
+void transformPositions(const Matrix44& matrix, const VertexStream& points, VertexStream& out);
+
+//normals are transformed with the inverse transpose of the model (so non uniform scales work) and normalized, w is 0
+void transformNormals(const Matrix44& model, const Vector3* normals, unsigned int count, VertexStream& out);
+void transformNormals(const Matrix44& model, const VertexStream& normals, VertexStream& out);
+
+//transform, perspective divide and viewport mapping in one pass:
+//x and y end in pixels (0..width, 0..height), z in NDC and w stores 1/w (for perspective correct interpolation)
+void projectPositions(const Matrix44& viewprojection, const Vector3* points, unsigned int count, float width, float height, VertexStream& out);
+void projectPositions(const Matrix44& viewprojection, const VertexStream& points, float width, float height, VertexStream& out);
+
+#endif
@@ -21,6 +21,8 @@
 #include "includes.h"
 #include "application.h"
 #include "image.h"
+#include "pipeline.h"
+#include "presenter.h"
 
 std::string getBinPath()
 {
@@ -115,6 +117,62 @@ SDL_Window* createWindow(const char* caption, int width, int height )
 }
 
 //The application main loop
+//when nothing changed the loop sleeps waiting for events, but wakes up after this time anyway (in ms)
+#define LOOP_IDLE_WAIT 100
+
+//returns false when the app must close, redraw is set when the window needs to be painted again
+static bool processEvent(Application* app, const SDL_Event& sdlEvent, bool& redraw)
+{
+	switch(sdlEvent.type)
+		{
+			case SDL_QUIT: return false; break; //EVENT for when the user clicks the [x] in the corner
+			case SDL_MOUSEBUTTONDOWN: //EXAMPLE OF sync mouse input
+				app->mouse_state |= SDL_BUTTON(sdlEvent.button.button);
+				app->onMouseButtonDown(sdlEvent.button);
+				break;
+			case SDL_MOUSEBUTTONUP:
+				app->mouse_state &= ~SDL_BUTTON(sdlEvent.button.button);
+				app->onMouseButtonUp(sdlEvent.button);
+				break;
+			case SDL_KEYDOWN: //EXAMPLE OF sync keyboard input
+				app->onKeyDown(sdlEvent.key);
+				break;
+			case SDL_KEYUP: //EXAMPLE OF sync keyboard input
+				app->onKeyUp(sdlEvent.key);
+				break;
+			case SDL_TEXTINPUT:
+				// you can read the ASCII character from sdlEvent.text.text 
+				break;
+			case SDL_WINDOWEVENT:
+				switch (sdlEvent.window.event) {
+					case SDL_WINDOWEVENT_RESIZED: //resize opengl context
+						std::cout << "window resize" << std::endl;
+						app->setWindowSize( sdlEvent.window.data1, sdlEvent.window.data2 );
+						redraw = true;
+						break;
+					case SDL_WINDOWEVENT_EXPOSED: //the window content was lost (uncovered, restored...)
+					case SDL_WINDOWEVENT_SIZE_CHANGED:
+						redraw = true;
+						break;
+				}
+		}
+	return true;
+}
+
+//when rendering in the worker, the main thread waits this long (in ms) for a frame before attending the events again
+#define LOOP_FRAME_WAIT 8
+
+static void presentFrame(Application* app, Image* frame)
+{
+	// Clear the window and the depth buffer
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	//copy to GPU
+	sendFramebufferToScreen(frame);
+	//swap between front buffer and back buffer to show it 
+	SDL_GL_SwapWindow(app->window);
+}
+
 void launchLoop(Application* app)
 {
 	SDL_Event sdlEvent;
@@ -126,6 +184,9 @@ void launchLoop(Application* app)
 	app->mouse_position.set(x,y);
 
 	double start_time = SDL_GetTicks();
+	bool redraw = true; //the first frame is always rendered
+	bool idle = false;
+	FramePipeline pipeline; //renders in a worker thread when app->render_buffers > 1
 
 	//infinite loop
 	while (1)
@@ -133,51 +194,39 @@ void launchLoop(Application* app)
 		//read keyboard state and stored in keystate
 		app->keystate = SDL_GetKeyboardState(NULL);
 
-		//Render frame and send it to screen
-
-			// Clear the window and the depth buffer
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
+		//start or stop the render worker when the mode changes, and give its buffers the size of the window
+		if (app->render_buffers > 1 && !pipeline.isRunning())
+		{
+			pipeline.start(app->render_buffers, app->framebuffer.width, app->framebuffer.height, app->framebuffer.layout);
+			redraw = true;
+		}
+		else if (app->render_buffers <= 1 && pipeline.isRunning())
+		{
+			pipeline.stop();
+			redraw = true;
+		}
+		if (pipeline.isRunning() && (pipeline.getWidth() != app->framebuffer.width || pipeline.getHeight() != app->framebuffer.height))
+			pipeline.resize(app->framebuffer.width, app->framebuffer.height);
+
+		//Render frame and send it to screen, only when the app has something new to show or the window needs it
+		Image* frame = NULL;
+		if (pipeline.isRunning())
+			frame = pipeline.acquire(pipeline.isBusy() ? LOOP_FRAME_WAIT : 0); //presented once the next one is queued
+		else if (redraw || app->needsRender())
+		{
 			//call render function
 			app->render(app->framebuffer);
+			presentFrame(app, &app->framebuffer);
+			redraw = false;
+		}
 
-			//copy to GPU
-			sendFramebufferToScreen(&app->framebuffer);
-			//swap between front buffer and back buffer to show it 
-			SDL_GL_SwapWindow(app->window);
-
-		//read events from the system
+		//read events from the system, if the last frame didn't change anything sleep until some event arrives
+		if (idle && SDL_WaitEventTimeout(&sdlEvent, LOOP_IDLE_WAIT))
+			if (!processEvent(app, sdlEvent, redraw))
+				return;
 		while(SDL_PollEvent(&sdlEvent))
-		{
-			switch(sdlEvent.type)
-				{
-					case SDL_QUIT: return; break; //EVENT for when the user clicks the [x] in the corner
-					case SDL_MOUSEBUTTONDOWN: //EXAMPLE OF sync mouse input
-						app->mouse_state |= SDL_BUTTON(sdlEvent.button.button);
-						app->onMouseButtonDown(sdlEvent.button);
-						break;
-					case SDL_MOUSEBUTTONUP:
-						app->mouse_state &= ~SDL_BUTTON(sdlEvent.button.button);
-						app->onMouseButtonUp(sdlEvent.button);
-						break;
-					case SDL_KEYDOWN: //EXAMPLE OF sync keyboard input
-						app->onKeyDown(sdlEvent.key);
-						break;
-					case SDL_KEYUP: //EXAMPLE OF sync keyboard input
-						app->onKeyUp(sdlEvent.key);
-						break;
-					case SDL_TEXTINPUT:
-						// you can read the ASCII character from sdlEvent.text.text 
-						break;
-					case SDL_WINDOWEVENT:
-						switch (sdlEvent.window.event) {
-							case SDL_WINDOWEVENT_RESIZED: //resize opengl context
-								std::cout << "window resize" << std::endl;
-								app->setWindowSize( sdlEvent.window.data1, sdlEvent.window.data2 );
-								break;
-						}
-				}
-		}
+			if (!processEvent(app, sdlEvent, redraw))
+				return;
 
 		//get mouse position and delta
 		app->mouse_state = SDL_GetMouseState(&x,&y);
@@ -187,11 +236,32 @@ void launchLoop(Application* app)
 
 		//update logic
 		double now = SDL_GetTicks();
+		if (idle)
+			last_time = now; //the time sleeping doesn't count, or the first update after it would jump
 		double elapsed_time = (now - last_time) * 0.001; //0.001 converts from milliseconds to seconds
 		app->time = (now - start_time) * 0.001;
 		app->update(elapsed_time);
 		last_time = now;
 
+		//queue the next frame before presenting the finished one, so the worker renders while the main thread presents
+		if (pipeline.isRunning())
+		{
+			if ((redraw || app->needsRender()) && pipeline.canSubmit())
+			{
+				Application::FrameState state = app->getFrameState();
+				pipeline.submit([app, state](Image& framebuffer) { app->render(framebuffer, state); });
+				redraw = false;
+			}
+			if (frame)
+			{
+				presentFrame(app, frame);
+				pipeline.release(frame);
+			}
+		}
+
+		//nothing to show after the update, the next iteration can wait for events
+		idle = !redraw && !app->needsRender() && !pipeline.isBusy();
+
 		//check errors in opengl only when working in debug
 		#ifdef _DEBUG
 			checkGLErrors();
@@ -203,6 +273,31 @@ void launchLoop(Application* app)
 
 void sendFramebufferToScreen( Image* img )
 {
+	//the texture and the pixel buffer live as long as the GL context
+	static Presenter* presenter = NULL;
+	if (!presenter)
+	{
+		presenter = new Presenter();
+		presenter->init();
+	}
+	if (presenter->isSupported())
+	{
+		presenter->upload(*img);
+		presenter->draw();
+		return;
+	}
+
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1 );
-	glDrawPixels(img->width, img->height, GL_RGB, GL_UNSIGNED_BYTE, img->pixels);
+
+	if (img->layout == LINEAR)
+	{
+		glDrawPixels(img->width, img->height, GL_RGB, GL_UNSIGNED_BYTE, img->pixels);
+		return;
+	}
+
+	//OpenGL wants the rows one after the other, tiled images are converted here (and only here)
+	static std::vector<Color> linear;
+	linear.resize(img->width * img->height);
+	img->copyToLinear(linear.data());
+	glDrawPixels(img->width, img->height, GL_RGB, GL_UNSIGNED_BYTE, linear.data());
 }
@@ -144,8 +144,7 @@ void Application::render(void)
 {
 	//update the aspect of the camera acording to the window size
 	camera->aspect = window_width / window_height;
-	camera->updateProjectionMatrix();
-	//Get the viewprojection matrix from our camera
+	//Get the viewprojection matrix from our camera (the matrices are rebuilt only if something changed)
 	Matrix44 viewprojection = camera->getViewProjectionMatrix();
 
 	//set the clear color of the colorbuffer as the ambient light so it matches
@@ -3,10 +3,15 @@
 #include "includes.h"
 #include <iostream>
 
+static bool sameVector(const Vector3& a, const Vector3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+
 Camera::Camera()
 {
+	version = 0;
+	fov = 45; aspect = 1;
 	view_matrix.setIdentity();
 	setOrthographic(-100,100,100,-100,-100,100);
+	updateViewMatrix(); //nothing to compute for orthographic, but it stores the current eye, center and up
 }
 
 void Camera::set()
@@ -86,8 +91,69 @@ void Camera::lookAt(const Vector3& eye, const Vector3& center, const Vector3& up
 	updateViewMatrix();
 }
 
+bool Camera::update()
+{
+	bool view_changed = !sameVector(eye, built_eye) || !sameVector(center, built_center) || !sameVector(up, built_up);
+	bool projection_changed = type != built_type || near_plane != built_near_plane || far_plane != built_far_plane;
+	if (type == PERSPECTIVE)
+		projection_changed = projection_changed || fov != built_fov || aspect != built_aspect;
+	else
+		projection_changed = projection_changed || left != built_left || right != built_right || top != built_top || bottom != built_bottom;
+
+	if (projection_changed)
+		updateProjectionMatrix();
+	if (view_changed)
+		updateViewMatrix();
+	return view_changed || projection_changed;
+}
+
+void Camera::updateDerivedData()
+{
+	viewprojection_matrix = view_matrix * projection_matrix;
+
+	inverse_viewprojection_matrix = viewprojection_matrix;
+	inverse_viewprojection_matrix.inverse();
+
+	//planes from the columns of the viewprojection (Gribb & Hartmann)
+	const float* m = viewprojection_matrix.m;
+	for (int i = 0; i < 4; ++i)
+	{
+		float cx = m[i * 4], cy = m[i * 4 + 1], cz = m[i * 4 + 2], cw = m[i * 4 + 3];
+		frustum_planes[0].v[i] = cw + cx;
+		frustum_planes[1].v[i] = cw - cx;
+		frustum_planes[2].v[i] = cw + cy;
+		frustum_planes[3].v[i] = cw - cy;
+		frustum_planes[4].v[i] = cw + cz;
+		frustum_planes[5].v[i] = cw - cz;
+	}
+	for (int i = 0; i < 6; ++i)
+	{
+		Vector4& p = frustum_planes[i];
+		float len = sqrtf(p.x * p.x + p.y * p.y + p.z * p.z);
+		if (len > 0.0f)
+			p.set(p.x / len, p.y / len, p.z / len, p.w / len);
+	}
+
+	++version;
+}
+
+bool Camera::testSphereInFrustum(const Vector3& center, float radius) const
+{
+	for (int i = 0; i < 6; ++i)
+	{
+		const Vector4& p = frustum_planes[i];
+		if (p.x * center.x + p.y * center.y + p.z * center.z + p.w < -radius)
+			return false;
+	}
+	return true;
+}
+
 void Camera::updateViewMatrix()
 {
+	built_eye = eye;
+	built_center = center;
+	built_up = up;
+
 	if (type != PERSPECTIVE)
 		return;
 
@@ -102,7 +168,7 @@ void Camera::updateViewMatrix()
 
 	//We get the matrix and store it in our app
 	glGetFloatv(GL_MODELVIEW_MATRIX, view_matrix.m );
-	viewprojection_matrix = view_matrix * projection_matrix;
+	updateDerivedData();
 }
 
 // ******************************************
@@ -110,6 +176,16 @@ void Camera::updateViewMatrix()
 //Create a projection matrix
 void Camera::updateProjectionMatrix()
 {
+	built_type = type;
+	built_fov = fov;
+	built_aspect = aspect;
+	built_near_plane = near_plane;
+	built_far_plane = far_plane;
+	built_left = left;
+	built_right = right;
+	built_top = top;
+	built_bottom = bottom;
+
 	//We activate the matrix we want to work: projection
 	glMatrixMode(GL_PROJECTION);
 
@@ -125,13 +201,11 @@ void Camera::updateProjectionMatrix()
 	glGetFloatv(GL_PROJECTION_MATRIX, projection_matrix.m );
 
 	glMatrixMode(GL_MODELVIEW);
-	viewprojection_matrix = view_matrix * projection_matrix;
+	updateDerivedData();
 }
 
 Matrix44 Camera::getViewProjectionMatrix()
 {
-	updateViewMatrix();
-	updateProjectionMatrix();
-	viewprojection_matrix = view_matrix * projection_matrix;
+	update();
 	return viewprojection_matrix;
 }
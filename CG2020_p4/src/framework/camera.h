@@ -37,6 +37,11 @@ public:
 	Matrix44 projection_matrix;
 	Matrix44 viewprojection_matrix;
 
+	//derived data, rebuilt together with the matrices
+	Matrix44 inverse_viewprojection_matrix;
+	Vector4 frustum_planes[6]; //left, right, bottom, top, near, far. Normalized (a,b,c,d), a*x+b*y+c*z+d >= 0 is inside
+	unsigned int version; //grows every time the matrices change
+
 	Camera();
 	void set();
 
@@ -52,11 +57,27 @@ public:
 	void setOrthographic(float left, float right, float top, float bottom, float near_plane, float far_plane);
 	void lookAt(const Vector3& eye, const Vector3& center, const Vector3& up);
 
-	//compute the matrices
+	//true if the sphere is (at least partially) inside the frustum
+	bool testSphereInFrustum(const Vector3& center, float radius) const;
+
+	//rebuilds only the matrices whose fields changed since the last time, returns true if something changed
+	bool update();
+
+	//compute the matrices (always)
 	void updateViewMatrix();
 	void updateProjectionMatrix();
 
+	//the cached matrix, rebuilt only if the camera changed
 	Matrix44 getViewProjectionMatrix();
+
+private:
+	//the fields used to build the current matrices
+	Vector3 built_eye, built_center, built_up;
+	char built_type;
+	float built_fov, built_aspect, built_near_plane, built_far_plane;
+	float built_left, built_right, built_top, built_bottom;
+
+	void updateDerivedData();
 };
 
 